@@ -37,6 +37,12 @@
 
 #include <string.h> // for memcpy
 #include <math.h>  // for pow
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
 
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
@@ -64,18 +70,51 @@ static gboolean gst_dalsa_src_start (GstBaseSrc * src);
 static gboolean gst_dalsa_src_stop (GstBaseSrc * src);
 static GstCaps *gst_dalsa_src_get_caps (GstBaseSrc * src, GstCaps * filter);
 static gboolean gst_dalsa_src_set_caps (GstBaseSrc * src, GstCaps * caps);
+static gboolean gst_dalsa_src_decide_allocation (GstBaseSrc * src, GstQuery * query);
+static gboolean gst_dalsa_src_unlock (GstBaseSrc * src);
+static gboolean gst_dalsa_src_unlock_stop (GstBaseSrc * src);
 
 static GstFlowReturn gst_dalsa_src_create (GstPushSrc * src, GstBuffer ** buf);
 
 //static GstCaps *gst_dalsa_src_create_caps (GstDalsaSrc * src);
 static void gst_dalsa_src_reset (GstDalsaSrc * src);
+static void gst_dalsa_bandwidth_leave (GstDalsaSrc * src);
+static void gst_dalsa_bandwidth_set_link_speed (GstDalsaSrc * src, guint link_speed);
+static void gst_dalsa_acq_leave (GstDalsaSrc * src);
 enum
 {
 	PROP_0,
 	PROP_CAMERA,
 	PROP_IP,
 	PROP_WIDTH,
-	PROP_HEIGHT
+	PROP_HEIGHT,
+	PROP_TURBO_DRIVE,
+	PROP_TURBO_DRIVE_ACTIVE,
+	PROP_LINK_SPEED,
+	PROP_COMPRESSION_RATIO,
+	PROP_LINK_UTILISATION,
+	PROP_CHUNK_MODE,
+	PROP_CHUNK_IDS,
+	PROP_PACKET_SIZE,
+	PROP_AUTO_PACKET_SIZE,
+	PROP_PACKET_DELAY,
+	PROP_PACKET_RESENDS,
+	PROP_STREAM_THREAD_AFFINITY,
+	PROP_STREAM_MEMORY_LIMIT,
+	PROP_BANDWIDTH_BUDGET,
+	PROP_PREVIEW_SCALE,
+	PROP_PREVIEW_INTERVAL,
+	PROP_ACCUMULATE,
+	PROP_ACCUMULATE_OUTPUT,
+	PROP_ACCUMULATE_SLIDING,
+	PROP_INCOMPLETE_POLICY,
+	PROP_RESEND_TIMEOUT,
+	PROP_FRAMES_LOST,
+	PROP_FRAMES_INCOMPLETE,
+	PROP_FRAMES_DROPPED,
+	PROP_FRAMES_OVERRUN,
+	PROP_ACQUISITION_MODE,
+	PROP_ACQUISITION_WORKERS
 };
 
 #define	FLYCAP_UPDATE_LOCAL  FALSE
@@ -105,8 +144,42 @@ enum
 #define DEFAULT_PROP_WIDTH 				640
 #define DEFAULT_PROP_HEIGHT			    480
 #define DEFAULT_PROP_IP					0
+#define DEFAULT_PROP_TURBO_DRIVE		FALSE
+#define DEFAULT_PROP_LINK_SPEED			1000  // Mbit/s
+#define DEFAULT_PROP_CHUNK_MODE			FALSE
+#define DEFAULT_PROP_CHUNK_IDS			NULL
+#define DEFAULT_PROP_PACKET_SIZE		0
+#define DEFAULT_PROP_AUTO_PACKET_SIZE	FALSE
+#define DEFAULT_PROP_PACKET_DELAY		-1
+#define DEFAULT_PROP_PACKET_RESENDS		-1
+#define DEFAULT_PROP_STREAM_THREAD_AFFINITY	-1
+#define DEFAULT_PROP_STREAM_MEMORY_LIMIT	0
+#define DEFAULT_PROP_BANDWIDTH_BUDGET	FALSE
+#define DEFAULT_PROP_PREVIEW_SCALE		0
+#define DEFAULT_PROP_PREVIEW_INTERVAL	1
+#define DEFAULT_PROP_ACCUMULATE			1
+#define DEFAULT_PROP_ACCUMULATE_OUTPUT	GST_ACCUMULATE_AVERAGE
+#define DEFAULT_PROP_ACCUMULATE_SLIDING	FALSE
+#define DEFAULT_PROP_INCOMPLETE_POLICY	GST_INCOMPLETE_DROP
+#define DEFAULT_PROP_RESEND_TIMEOUT		0
+#define DEFAULT_PROP_ACQUISITION_MODE	GST_ACQUISITION_WAIT
+#define DEFAULT_PROP_ACQUISITION_WORKERS	2
+
+#define ACQ_WAIT_TIMEOUT_MS				1000  // longest a create() waits before checking for flushing
+#define ACQ_WORKER_WAIT_MS				2     // longest a worker parks on one camera while it has others
+#define ACQ_WORKER_PARK_MS				100   // wait timeout of a worker with a single camera, bounds leave()
+#define MAX_ACQ_WORKERS					16
+
+#define GVSP_PACKET_OVERHEAD			36    // IP + UDP + GVSP headers inside GevSCPSPacketSize
+#define ETHERNET_OVERHEAD				38    // preamble, header, FCS and inter-frame gap on the wire
+#define BANDWIDTH_BUDGET_FRACTION		0.9   // share of link-speed handed out by the bandwidth budget
+
+#define STAT_WINDOW						GST_SECOND  // compression/utilisation averaging window
+#define BLOCK_ID_WRAP_WINDOW			1024  // a backward block ID jump across this many IDs of 0xFFFF is a wrap
 
 #define DEFAULT_GST_VIDEO_FORMAT GST_VIDEO_FORMAT_GRAY8
+#define POOL_STRIDE_ALIGN				31    // 32 byte aligned rows when downstream supports GstVideoMeta
+#define PREVIEW_POOL_MIN				2
 #define DEFAULT_FLYCAP_VIDEO_FORMAT FC2_PIXEL_FORMAT_RGB8
 // Put matching type text in the pad template below
 
@@ -115,6 +188,14 @@ static GstStaticPadTemplate gst_dalsa_src_template =
 		GST_STATIC_PAD_TEMPLATE ("src",
 				GST_PAD_SRC,
 				GST_PAD_ALWAYS,
+				GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE
+						("{ GRAY8, GRAY16_LE }"))
+		);
+
+static GstStaticPadTemplate gst_dalsa_src_preview_template =
+		GST_STATIC_PAD_TEMPLATE ("preview",
+				GST_PAD_SRC,
+				GST_PAD_SOMETIMES,
 				GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE
 						("{ GRAY8 }"))
 		);
@@ -128,6 +209,61 @@ static GstStaticPadTemplate gst_dalsa_src_template =
 	}\
 }
 
+#define GST_TYPE_ACCUMULATE_OUTPUT (gst_dalsa_src_accumulate_output_get_type())
+static GType
+gst_dalsa_src_accumulate_output_get_type (void)
+{
+	static GType accumulate_output_type = 0;
+	static const GEnumValue accumulate_output[] = {
+		{GST_ACCUMULATE_AVERAGE, "Average of the frames as GRAY8", "average"},
+		{GST_ACCUMULATE_SUM, "Sum of the frames as GRAY16", "sum"},
+		{0, NULL, NULL},
+	};
+
+	if (!accumulate_output_type) {
+		accumulate_output_type =
+				g_enum_register_static ("GstDalsaAccumulateOutput", accumulate_output);
+	}
+	return accumulate_output_type;
+}
+
+#define GST_TYPE_INCOMPLETE_POLICY (gst_dalsa_src_incomplete_policy_get_type())
+static GType
+gst_dalsa_src_incomplete_policy_get_type (void)
+{
+	static GType incomplete_policy_type = 0;
+	static const GEnumValue incomplete_policy[] = {
+		{GST_INCOMPLETE_DROP, "Drop incomplete frames", "drop"},
+		{GST_INCOMPLETE_PUSH_CORRUPT, "Push incomplete frames flagged as corrupted", "push-corrupt"},
+		{GST_INCOMPLETE_WAIT, "Wait up to resend-timeout for resent packets, then drop", "wait"},
+		{0, NULL, NULL},
+	};
+
+	if (!incomplete_policy_type) {
+		incomplete_policy_type =
+				g_enum_register_static ("GstDalsaIncompletePolicy", incomplete_policy);
+	}
+	return incomplete_policy_type;
+}
+
+#define GST_TYPE_ACQUISITION_MODE (gst_dalsa_src_acquisition_mode_get_type())
+static GType
+gst_dalsa_src_acquisition_mode_get_type (void)
+{
+	static GType acquisition_mode_type = 0;
+	static const GEnumValue acquisition_mode[] = {
+		{GST_ACQUISITION_WAIT, "Streaming thread waits in the GigeV library", "wait"},
+		{GST_ACQUISITION_SHARED, "Shared worker pool wakes the streaming thread through an eventfd", "shared"},
+		{0, NULL, NULL},
+	};
+
+	if (!acquisition_mode_type) {
+		acquisition_mode_type =
+				g_enum_register_static ("GstDalsaAcquisitionMode", acquisition_mode);
+	}
+	return acquisition_mode_type;
+}
+
 G_DEFINE_TYPE_WITH_CODE (GstDalsaSrc, gst_dalsa_src, GST_TYPE_PUSH_SRC,
     GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "dalsa", 0,
         "debug category for dalsa element"));
@@ -151,6 +287,8 @@ gst_dalsa_src_class_init (GstDalsaSrcClass * klass)
 
 	gst_element_class_add_pad_template (gstelement_class,
 			gst_static_pad_template_get (&gst_dalsa_src_template));
+	gst_element_class_add_pad_template (gstelement_class,
+			gst_static_pad_template_get (&gst_dalsa_src_preview_template));
 
 	gst_element_class_set_static_metadata (gstelement_class,
 			"dalsa Video Source", "Source/Video",
@@ -160,6 +298,9 @@ gst_dalsa_src_class_init (GstDalsaSrcClass * klass)
 	gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_dalsa_src_stop);
 	gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_dalsa_src_get_caps);
 	gstbasesrc_class->set_caps = GST_DEBUG_FUNCPTR (gst_dalsa_src_set_caps);
+	gstbasesrc_class->decide_allocation = GST_DEBUG_FUNCPTR (gst_dalsa_src_decide_allocation);
+	gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_dalsa_src_unlock);
+	gstbasesrc_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_dalsa_src_unlock_stop);
 
 	gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_dalsa_src_create);
 
@@ -171,6 +312,94 @@ gst_dalsa_src_class_init (GstDalsaSrcClass * klass)
 	g_object_class_install_property (gobject_class, PROP_IP,
 		g_param_spec_ulong("camera-ip", "Camera IP", "Camera IP address to open, formatted as unsigned long. (Optional. Use instead of camera-id)", 0, 4294967294, DEFAULT_PROP_IP,
 		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+	//TurboDrive
+	g_object_class_install_property (gobject_class, PROP_TURBO_DRIVE,
+		g_param_spec_boolean("turbo-drive", "TurboDrive", "Enable TurboDrive lossless transfer compression if the camera supports it for the current pixel format. Decompression is done by the GigeV library.", DEFAULT_PROP_TURBO_DRIVE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_TURBO_DRIVE_ACTIVE,
+		g_param_spec_boolean("turbo-drive-active", "TurboDrive active", "TRUE if TurboDrive was enabled on the camera at start.", FALSE,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	g_object_class_install_property (gobject_class, PROP_LINK_SPEED,
+		g_param_spec_uint("link-speed", "Link speed", "Speed of the camera network link in Mbit/s, used to compute link-utilisation.", 1, 100000, DEFAULT_PROP_LINK_SPEED,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+	g_object_class_install_property (gobject_class, PROP_COMPRESSION_RATIO,
+		g_param_spec_double("compression-ratio", "Compression ratio", "Decompressed image bytes divided by bytes received on the wire, averaged over the last second.", 0.0, G_MAXDOUBLE, 1.0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	g_object_class_install_property (gobject_class, PROP_LINK_UTILISATION,
+		g_param_spec_double("link-utilisation", "Link utilisation", "Fraction of link-speed used by all received data, chunk data included, over the last second.", 0.0, G_MAXDOUBLE, 0.0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	//chunk data
+	g_object_class_install_property (gobject_class, PROP_CHUNK_MODE,
+		g_param_spec_boolean("chunk-mode", "Chunk mode", "Enable GenICam chunk data and attach it to every buffer as GstDalsaChunkMeta. The GEV frame ID and timestamp are always attached.", DEFAULT_PROP_CHUNK_MODE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_CHUNK_IDS,
+		g_param_spec_string("chunk-ids", "Chunk IDs", "Comma separated ChunkSelector:ChunkID pairs to enable, as found in the camera XML, e.g. \"ExposureTime:0xA0001001,LineStatusAll:0xA0001006\". Supported selectors: ExposureTime, Gain, FrameID, LineStatusAll, EncoderValue, Timestamp.", DEFAULT_PROP_CHUNK_IDS,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	//transport
+	g_object_class_install_property (gobject_class, PROP_PACKET_SIZE,
+		g_param_spec_int("packet-size", "Packet size", "Stream packet size (GevSCPSPacketSize) in bytes. 0 keeps the camera setting.", 0, 16384, DEFAULT_PROP_PACKET_SIZE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_AUTO_PACKET_SIZE,
+		g_param_spec_boolean("auto-packet-size", "Auto packet size", "Use the largest packet size allowed by the MTU of the network interface the camera is on (jumbo frames). Overrides packet-size.", DEFAULT_PROP_AUTO_PACKET_SIZE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_PACKET_DELAY,
+		g_param_spec_int("packet-delay", "Packet delay", "Inter-packet delay (GevSCPD) in camera timestamp ticks. -1 keeps the camera setting. Ignored when bandwidth-budget is set.", -1, G_MAXINT, DEFAULT_PROP_PACKET_DELAY,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_PACKET_RESENDS,
+		g_param_spec_int("packet-resends", "Packet resends", "Maximum number of packet resend requests per frame. -1 keeps the library default.", -1, G_MAXINT, DEFAULT_PROP_PACKET_RESENDS,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_STREAM_THREAD_AFFINITY,
+		g_param_spec_int("stream-thread-affinity", "Stream thread affinity", "CPU to pin the GigeV receive thread to. -1 lets the scheduler choose.", -1, 1023, DEFAULT_PROP_STREAM_THREAD_AFFINITY,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_STREAM_MEMORY_LIMIT,
+		g_param_spec_uint("stream-memory-limit", "Stream memory limit", "Maximum memory in bytes the GigeV library may use to buffer incoming packets. 0 keeps the library default.", 0, G_MAXUINT, DEFAULT_PROP_STREAM_MEMORY_LIMIT,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_BANDWIDTH_BUDGET,
+		g_param_spec_boolean("bandwidth-budget", "Bandwidth budget", "Coordinate the inter-packet delay with every other dalsasrc in this process on the same network interface so that together they stay under link-speed.", DEFAULT_PROP_BANDWIDTH_BUDGET,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	//preview pad
+	g_object_class_install_property (gobject_class, PROP_PREVIEW_SCALE,
+		g_param_spec_uint("preview-scale", "Preview scale", "Add a 'preview' src pad carrying a box-filtered 1/2, 1/4 or 1/8 downscale, computed while copying the main frame. 0 disables the pad.", 0, 8, DEFAULT_PROP_PREVIEW_SCALE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_PREVIEW_INTERVAL,
+		g_param_spec_uint("preview-interval", "Preview interval", "Only produce a preview for every n-th frame.", 1, G_MAXUINT, DEFAULT_PROP_PREVIEW_INTERVAL,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	//frame accumulation
+	g_object_class_install_property (gobject_class, PROP_ACCUMULATE,
+		g_param_spec_uint("accumulate", "Accumulate", "Number of consecutive frames summed into each output frame, for low light capture. 1 disables accumulation.", 1, 256, DEFAULT_PROP_ACCUMULATE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_ACCUMULATE_OUTPUT,
+		g_param_spec_enum("accumulate-output", "Accumulate output", "Output the average (GRAY8) or the sum (GRAY16) of the accumulated frames.", GST_TYPE_ACCUMULATE_OUTPUT, DEFAULT_PROP_ACCUMULATE_OUTPUT,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_ACCUMULATE_SLIDING,
+		g_param_spec_boolean("accumulate-sliding", "Sliding accumulation", "Output a frame for every input frame, accumulated over the last 'accumulate' frames, instead of one per block. Keeps the last 'accumulate' frames in memory.", DEFAULT_PROP_ACCUMULATE_SLIDING,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	//frame loss
+	g_object_class_install_property (gobject_class, PROP_INCOMPLETE_POLICY,
+		g_param_spec_enum("incomplete-policy", "Incomplete policy", "What to do with frames that arrive with missing packets. Dropped and lost frames are signalled downstream with GAP events.", GST_TYPE_INCOMPLETE_POLICY, DEFAULT_PROP_INCOMPLETE_POLICY,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_RESEND_TIMEOUT,
+		g_param_spec_uint("resend-timeout", "Resend timeout", "With incomplete-policy=wait, how long in ms the library keeps a frame open for resent packets. 0 keeps the library default.", 0, G_MAXUINT, DEFAULT_PROP_RESEND_TIMEOUT,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_FRAMES_LOST,
+		g_param_spec_uint64("frames-lost", "Frames lost", "Number of frames whose block ID never arrived.", 0, G_MAXUINT64, 0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	g_object_class_install_property (gobject_class, PROP_FRAMES_INCOMPLETE,
+		g_param_spec_uint64("frames-incomplete", "Frames incomplete", "Number of frames received with missing packets.", 0, G_MAXUINT64, 0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	g_object_class_install_property (gobject_class, PROP_FRAMES_DROPPED,
+		g_param_spec_uint64("frames-dropped", "Frames dropped", "Number of incomplete frames that were not pushed downstream.", 0, G_MAXUINT64, 0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	g_object_class_install_property (gobject_class, PROP_FRAMES_OVERRUN,
+		g_param_spec_uint("frames-overrun", "Frames overrun", "Number of complete frames dropped in shared acquisition because the streaming thread fell behind.", 0, G_MAXUINT, 0,
+		 (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+	//acquisition
+	g_object_class_install_property (gobject_class, PROP_ACQUISITION_MODE,
+		g_param_spec_enum("acquisition-mode", "Acquisition mode", "How images are collected from the GigeV library. 'wait' blocks the streaming thread in the library and has the lowest latency. 'shared' adds a pool of worker threads that collect images for every dalsasrc in the process and wake the streaming thread through an eventfd, so a flush or stop interrupts a waiting element at once. The GigeV API has no frame-ready callback, so 'shared' does not reduce the number of threads: each element keeps its streaming thread, every frame takes one extra thread hop, and a worker serving several cameras can delay a frame by up to 2 ms.", GST_TYPE_ACQUISITION_MODE, DEFAULT_PROP_ACQUISITION_MODE,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+	g_object_class_install_property (gobject_class, PROP_ACQUISITION_WORKERS,
+		g_param_spec_uint("acquisition-workers", "Acquisition workers", "Number of threads in the shared acquisition pool. Only used by the element that starts the pool. With fewer workers than cameras a frame can wait up to 2 ms for its worker.", 1, MAX_ACQ_WORKERS, DEFAULT_PROP_ACQUISITION_WORKERS,
+		 (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 }
 
 static void
@@ -188,6 +417,36 @@ init_properties(GstDalsaSrc * src)
   src->gst_stride = src->pitch;
   src->cameraID = DEFAULT_PROP_CAMERA;
   src->cameraIP = DEFAULT_PROP_IP;
+  src->turbo_drive = DEFAULT_PROP_TURBO_DRIVE;
+  src->link_speed = DEFAULT_PROP_LINK_SPEED;
+  src->chunk_mode = DEFAULT_PROP_CHUNK_MODE;
+  src->chunk_ids = DEFAULT_PROP_CHUNK_IDS;
+  src->n_chunk_map = 0;
+  src->packet_size = DEFAULT_PROP_PACKET_SIZE;
+  src->auto_packet_size = DEFAULT_PROP_AUTO_PACKET_SIZE;
+  src->packet_delay = DEFAULT_PROP_PACKET_DELAY;
+  src->packet_resends = DEFAULT_PROP_PACKET_RESENDS;
+  src->stream_thread_affinity = DEFAULT_PROP_STREAM_THREAD_AFFINITY;
+  src->stream_memory_limit = DEFAULT_PROP_STREAM_MEMORY_LIMIT;
+  src->bandwidth_budget = DEFAULT_PROP_BANDWIDTH_BUDGET;
+  src->preview_scale = DEFAULT_PROP_PREVIEW_SCALE;
+  src->preview_interval = DEFAULT_PROP_PREVIEW_INTERVAL;
+  src->preview_pad = NULL;
+  src->preview_pool = NULL;
+  src->preview_probe = 0;
+  src->preview_acc = NULL;
+  src->accumulate = DEFAULT_PROP_ACCUMULATE;
+  src->accumulate_output = DEFAULT_PROP_ACCUMULATE_OUTPUT;
+  src->accumulate_sliding = DEFAULT_PROP_ACCUMULATE_SLIDING;
+  src->acc = NULL;
+  src->acc_history = NULL;
+  src->incomplete_policy = DEFAULT_PROP_INCOMPLETE_POLICY;
+  src->resend_timeout = DEFAULT_PROP_RESEND_TIMEOUT;
+  src->acquisition_mode = DEFAULT_PROP_ACQUISITION_MODE;
+  src->acquisition_workers = DEFAULT_PROP_ACQUISITION_WORKERS;
+  src->acq_shared = FALSE;
+  src->acq_worker = G_MAXUINT;
+  src->event_fd = -1;
 
 }
 
@@ -201,6 +460,7 @@ gst_dalsa_src_init (GstDalsaSrc * src)
 	gst_base_src_set_format (GST_BASE_SRC (src), GST_FORMAT_TIME);
 
 	init_properties(src);
+	g_mutex_init (&src->acq_lock);
 
 	gst_dalsa_src_reset (src);
 }
@@ -211,8 +471,55 @@ gst_dalsa_src_reset (GstDalsaSrc * src)
 	src->n_frames = 0;
 	src->total_timeouts = 0;
 	src->last_frame_time = 0;
+	src->last_running_time = GST_CLOCK_TIME_NONE;
 	src->cameraID = DEFAULT_PROP_CAMERA;
 	src->cameraIP = DEFAULT_PROP_IP;
+	src->turbo_drive_active = FALSE;
+	src->compression_ratio = 1.0;
+	src->link_utilisation = 0.0;
+	src->stat_image_bytes = 0;
+	src->stat_wire_bytes = 0;
+	src->stat_link_bytes = 0;
+	src->stat_window_start = GST_CLOCK_TIME_NONE;
+	src->have_block_id = FALSE;
+	src->last_block_id = 0;
+	src->frames_lost = 0;
+	src->frames_incomplete = 0;
+	src->frames_dropped = 0;
+	g_atomic_int_set (&src->frames_overrun, 0);
+	src->acq_head = 0;
+	src->acq_len = 0;
+	src->acq_overrun = 0;
+	src->flushing = FALSE;
+}
+
+// Parses the chunk-ids property into src->chunk_map. Unknown selectors are skipped with a warning.
+static void
+gst_dalsa_src_parse_chunk_ids (GstDalsaSrc * src)
+{
+	gchar **pairs;
+
+	src->n_chunk_map = 0;
+	if (src->chunk_ids == NULL)
+		return;
+
+	pairs = g_strsplit (src->chunk_ids, ",", -1);
+	for (int i = 0; pairs[i] != NULL && src->n_chunk_map < GST_DALSA_CHUNK_MAX; i++) {
+		gchar **kv = g_strsplit (g_strstrip (pairs[i]), ":", 2);
+
+		if (kv[0] != NULL && kv[1] != NULL) {
+			guint32 id = (guint32) g_ascii_strtoull (kv[1], NULL, 0);
+
+			if (gst_dalsa_chunk_map_entry_init (&src->chunk_map[src->n_chunk_map], kv[0], id))
+				src->n_chunk_map++;
+			else
+				GST_WARNING_OBJECT (src, "unsupported chunk selector %s", kv[0]);
+		} else if (*pairs[i] != '\0') {
+			GST_WARNING_OBJECT (src, "malformed chunk-ids entry '%s'", pairs[i]);
+		}
+		g_strfreev (kv);
+	}
+	g_strfreev (pairs);
 }
 
 void
@@ -236,6 +543,72 @@ gst_dalsa_src_set_property (GObject * object, guint property_id,
 		break;
 	case PROP_HEIGHT:
 		break;
+	case PROP_TURBO_DRIVE:
+		src->turbo_drive = g_value_get_boolean (value);
+		break;
+	case PROP_LINK_SPEED:
+		gst_dalsa_bandwidth_set_link_speed (src, g_value_get_uint (value));
+		break;
+	case PROP_CHUNK_MODE:
+		src->chunk_mode = g_value_get_boolean (value);
+		break;
+	case PROP_CHUNK_IDS:
+		g_free (src->chunk_ids);
+		src->chunk_ids = g_value_dup_string (value);
+		gst_dalsa_src_parse_chunk_ids (src);
+		break;
+	case PROP_PACKET_SIZE:
+		src->packet_size = g_value_get_int (value);
+		break;
+	case PROP_AUTO_PACKET_SIZE:
+		src->auto_packet_size = g_value_get_boolean (value);
+		break;
+	case PROP_PACKET_DELAY:
+		src->packet_delay = g_value_get_int (value);
+		break;
+	case PROP_PACKET_RESENDS:
+		src->packet_resends = g_value_get_int (value);
+		break;
+	case PROP_STREAM_THREAD_AFFINITY:
+		src->stream_thread_affinity = g_value_get_int (value);
+		break;
+	case PROP_STREAM_MEMORY_LIMIT:
+		src->stream_memory_limit = g_value_get_uint (value);
+		break;
+	case PROP_BANDWIDTH_BUDGET:
+		src->bandwidth_budget = g_value_get_boolean (value);
+		break;
+	case PROP_PREVIEW_SCALE:
+		src->preview_scale = g_value_get_uint (value);
+		if (src->preview_scale != 0 && src->preview_scale != 2 && src->preview_scale != 4 && src->preview_scale != 8) {
+			GST_WARNING_OBJECT (src, "preview-scale must be 0, 2, 4 or 8, disabling preview");
+			src->preview_scale = 0;
+		}
+		break;
+	case PROP_PREVIEW_INTERVAL:
+		src->preview_interval = g_value_get_uint (value);
+		break;
+	case PROP_ACCUMULATE:
+		src->accumulate = g_value_get_uint (value);
+		break;
+	case PROP_ACCUMULATE_OUTPUT:
+		src->accumulate_output = g_value_get_enum (value);
+		break;
+	case PROP_ACCUMULATE_SLIDING:
+		src->accumulate_sliding = g_value_get_boolean (value);
+		break;
+	case PROP_INCOMPLETE_POLICY:
+		src->incomplete_policy = g_value_get_enum (value);
+		break;
+	case PROP_RESEND_TIMEOUT:
+		src->resend_timeout = g_value_get_uint (value);
+		break;
+	case PROP_ACQUISITION_MODE:
+		src->acquisition_mode = g_value_get_enum (value);
+		break;
+	case PROP_ACQUISITION_WORKERS:
+		src->acquisition_workers = g_value_get_uint (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 		break;
@@ -253,6 +626,99 @@ gst_dalsa_src_get_property (GObject * object, guint property_id,
 
 	g_return_if_fail (GST_IS_DALSA_SRC (object));
 	src = GST_DALSA_SRC (object);
+
+	switch (property_id) {
+	case PROP_CAMERA:
+		g_value_set_int (value, src->cameraID);
+		break;
+	case PROP_IP:
+		g_value_set_ulong (value, src->cameraIP);
+		break;
+	case PROP_TURBO_DRIVE:
+		g_value_set_boolean (value, src->turbo_drive);
+		break;
+	case PROP_TURBO_DRIVE_ACTIVE:
+		g_value_set_boolean (value, src->turbo_drive_active);
+		break;
+	case PROP_LINK_SPEED:
+		g_value_set_uint (value, src->link_speed);
+		break;
+	case PROP_COMPRESSION_RATIO:
+		g_value_set_double (value, src->compression_ratio);
+		break;
+	case PROP_LINK_UTILISATION:
+		g_value_set_double (value, src->link_utilisation);
+		break;
+	case PROP_CHUNK_MODE:
+		g_value_set_boolean (value, src->chunk_mode);
+		break;
+	case PROP_CHUNK_IDS:
+		g_value_set_string (value, src->chunk_ids);
+		break;
+	case PROP_PACKET_SIZE:
+		g_value_set_int (value, src->packet_size);
+		break;
+	case PROP_AUTO_PACKET_SIZE:
+		g_value_set_boolean (value, src->auto_packet_size);
+		break;
+	case PROP_PACKET_DELAY:
+		g_value_set_int (value, src->packet_delay);
+		break;
+	case PROP_PACKET_RESENDS:
+		g_value_set_int (value, src->packet_resends);
+		break;
+	case PROP_STREAM_THREAD_AFFINITY:
+		g_value_set_int (value, src->stream_thread_affinity);
+		break;
+	case PROP_STREAM_MEMORY_LIMIT:
+		g_value_set_uint (value, src->stream_memory_limit);
+		break;
+	case PROP_BANDWIDTH_BUDGET:
+		g_value_set_boolean (value, src->bandwidth_budget);
+		break;
+	case PROP_PREVIEW_SCALE:
+		g_value_set_uint (value, src->preview_scale);
+		break;
+	case PROP_PREVIEW_INTERVAL:
+		g_value_set_uint (value, src->preview_interval);
+		break;
+	case PROP_ACCUMULATE:
+		g_value_set_uint (value, src->accumulate);
+		break;
+	case PROP_ACCUMULATE_OUTPUT:
+		g_value_set_enum (value, src->accumulate_output);
+		break;
+	case PROP_ACCUMULATE_SLIDING:
+		g_value_set_boolean (value, src->accumulate_sliding);
+		break;
+	case PROP_INCOMPLETE_POLICY:
+		g_value_set_enum (value, src->incomplete_policy);
+		break;
+	case PROP_RESEND_TIMEOUT:
+		g_value_set_uint (value, src->resend_timeout);
+		break;
+	case PROP_FRAMES_LOST:
+		g_value_set_uint64 (value, src->frames_lost);
+		break;
+	case PROP_FRAMES_INCOMPLETE:
+		g_value_set_uint64 (value, src->frames_incomplete);
+		break;
+	case PROP_FRAMES_DROPPED:
+		g_value_set_uint64 (value, src->frames_dropped);
+		break;
+	case PROP_FRAMES_OVERRUN:
+		g_value_set_uint (value, (guint) g_atomic_int_get (&src->frames_overrun));
+		break;
+	case PROP_ACQUISITION_MODE:
+		g_value_set_enum (value, src->acquisition_mode);
+		break;
+	case PROP_ACQUISITION_WORKERS:
+		g_value_set_uint (value, src->acquisition_workers);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+		break;
+	}
 }
 
 void
@@ -281,9 +747,775 @@ gst_dalsa_src_finalize (GObject * object)
 	GST_DEBUG_OBJECT (src, "finalize");
 
 	/* clean up object here */
+	// Normally done in stop(), but make sure no budget ever refers to a freed element
+	gst_dalsa_bandwidth_leave (src);
+	gst_dalsa_acq_leave (src);
+	g_free (src->chunk_ids);
+	src->chunk_ids = NULL;
+	g_mutex_clear (&src->acq_lock);
+
 	G_OBJECT_CLASS (gst_dalsa_src_parent_class)->finalize (object);
 }
 
+// Returns TRUE if the camera can send TurboDrive compressed data for the current pixel format.
+// Follows the check used by the GigeV examples: the standard feature first (it really is spelled
+// "Abailable"), then the legacy capability selector.
+static gboolean
+gst_dalsa_src_turbo_drive_available (GstDalsaSrc * src)
+{
+	int type;
+	UINT32 val = 0;
+	char pxlfmt_str[64] = {0};
+
+	if (GevGetFeatureValue (src->camHandle, "transferTurboCurrentlyAbailable", &type, sizeof(UINT32), &val) == 0)
+		return (val != 0);
+
+	GevGetFeatureValueAsString (src->camHandle, "PixelFormat", &type, sizeof(pxlfmt_str), pxlfmt_str);
+	return (GevSetFeatureValueAsString (src->camHandle, "transferTurboCapabilitySelector", pxlfmt_str) == 0);
+}
+
+// Accumulates wire/image byte counts and refreshes compression-ratio and link-utilisation once per STAT_WINDOW.
+// recv_size is the number of bytes the library received for the frame, i.e. the compressed size with TurboDrive.
+// It includes the chunk data, which is not part of the image, so that is left out of the ratio.
+static void
+gst_dalsa_src_update_transfer_stats (GstDalsaSrc * src, GEV_BUFFER_OBJECT * img)
+{
+	GstClockTime now = gst_util_get_timestamp ();
+	GstClockTime elapsed;
+	guint64 image_wire_bytes = img->recv_size;
+
+	if (img->chunk_data != NULL && img->chunk_size < image_wire_bytes)
+		image_wire_bytes -= img->chunk_size;
+
+	src->stat_image_bytes += (guint64) img->h * img->w * src->bytesPerPixel;
+	src->stat_wire_bytes += image_wire_bytes;
+	src->stat_link_bytes += img->recv_size;
+
+	if (!GST_CLOCK_TIME_IS_VALID (src->stat_window_start)) {
+		src->stat_window_start = now;
+		return;
+	}
+	elapsed = now - src->stat_window_start;
+	if (elapsed < STAT_WINDOW)
+		return;
+
+	if (src->stat_wire_bytes > 0)
+		src->compression_ratio = (gdouble) src->stat_image_bytes / src->stat_wire_bytes;
+	src->link_utilisation = (src->stat_link_bytes * 8.0 * GST_SECOND / elapsed) / (src->link_speed * 1e6);
+
+	GST_DEBUG_OBJECT (src, "compression ratio %.2f, link utilisation %.1f%%",
+			src->compression_ratio, src->link_utilisation * 100.0);
+
+	src->stat_image_bytes = 0;
+	src->stat_wire_bytes = 0;
+	src->stat_link_bytes = 0;
+	src->stat_window_start = now;
+}
+
+//=====================================================================================
+// Bandwidth budget
+//
+// Cameras on one NIC send each frame as a burst at line rate. When several bursts overlap
+// the switch/NIC drops packets and frames arrive incomplete. Every dalsasrc with
+// bandwidth-budget set registers here; the members of one interface get a share of
+// link-speed proportional to what they need, enforced through the inter-packet delay.
+
+G_LOCK_DEFINE_STATIC (bandwidth_budget);
+static GList *bandwidth_members = NULL;
+
+// Recompute GevSCPD for every member on if_index. Must be called with the bandwidth_budget lock held.
+// The interface capacity is the lowest link-speed any member reports, so a budget is never overcommitted.
+static void
+gst_dalsa_bandwidth_rebalance (guint if_index)
+{
+	gdouble total = 0.0;
+	guint link_speed = 0;
+	gboolean mismatch = FALSE;
+	gdouble link_bps;
+	GList *l;
+
+	for (l = bandwidth_members; l != NULL; l = l->next) {
+		GstDalsaSrc *member = l->data;
+
+		if (member->if_index != if_index)
+			continue;
+		total += member->bandwidth_demand;
+		if (link_speed != 0 && member->link_speed != link_speed)
+			mismatch = TRUE;
+		if (link_speed == 0 || member->link_speed < link_speed)
+			link_speed = member->link_speed;
+	}
+	if (total <= 0.0)
+		return;
+
+	if (mismatch)
+		GST_WARNING ("dalsasrc elements on interface %u disagree on link-speed, using %u Mbit/s",
+				if_index, link_speed);
+	link_bps = link_speed * 1e6;
+
+	if (total > link_bps * BANDWIDTH_BUDGET_FRACTION)
+		GST_WARNING ("interface %u is oversubscribed: %.0f Mbit/s requested of %.0f Mbit/s",
+				if_index, total / 1e6, link_bps / 1e6);
+
+	for (l = bandwidth_members; l != NULL; l = l->next) {
+		GstDalsaSrc *member = l->data;
+		gdouble share, packet_bits, delay;
+		UINT32 ticks;
+
+		if (member->if_index != if_index)
+			continue;
+
+		// Peak rate allowed for this camera, then the gap after each packet that produces it
+		share = link_bps * BANDWIDTH_BUDGET_FRACTION * member->bandwidth_demand / total;
+		packet_bits = (member->effective_packet_size + ETHERNET_OVERHEAD) * 8.0;
+		delay = packet_bits / share - packet_bits / link_bps;
+		ticks = (delay > 0.0) ? (UINT32) (delay * member->tick_frequency) : 0;
+
+		if (GevSetFeatureValue (member->camHandle, "GevSCPD", sizeof(UINT32), &ticks) != 0)
+			GST_WARNING_OBJECT (member, "could not set GevSCPD");
+		GST_DEBUG_OBJECT (member, "bandwidth share %.0f Mbit/s, packet delay %u ticks", share / 1e6, ticks);
+	}
+}
+
+static void
+gst_dalsa_bandwidth_join (GstDalsaSrc * src)
+{
+	G_LOCK (bandwidth_budget);
+	bandwidth_members = g_list_prepend (bandwidth_members, src);
+	gst_dalsa_bandwidth_rebalance (src->if_index);
+	G_UNLOCK (bandwidth_budget);
+}
+
+static void
+gst_dalsa_bandwidth_leave (GstDalsaSrc * src)
+{
+	G_LOCK (bandwidth_budget);
+	if (g_list_find (bandwidth_members, src) != NULL) {
+		bandwidth_members = g_list_remove (bandwidth_members, src);
+		gst_dalsa_bandwidth_rebalance (src->if_index);
+	}
+	G_UNLOCK (bandwidth_budget);
+}
+
+// link-speed can change while playing; members of a budget get their delays recomputed right away
+static void
+gst_dalsa_bandwidth_set_link_speed (GstDalsaSrc * src, guint link_speed)
+{
+	G_LOCK (bandwidth_budget);
+	src->link_speed = link_speed;
+	if (g_list_find (bandwidth_members, src) != NULL)
+		gst_dalsa_bandwidth_rebalance (src->if_index);
+	G_UNLOCK (bandwidth_budget);
+}
+
+// Returns the MTU of the host interface, or 0 if it can not be read.
+static guint
+gst_dalsa_src_probe_mtu (GstDalsaSrc * src)
+{
+	struct ifreq ifr = {0};
+	int fd;
+	guint mtu = 0;
+
+	if (if_indextoname (src->if_index, ifr.ifr_name) == NULL)
+		return 0;
+	fd = socket (AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return 0;
+	if (ioctl (fd, SIOCGIFMTU, &ifr) == 0)
+		mtu = ifr.ifr_mtu;
+	close (fd);
+
+	GST_DEBUG_OBJECT (src, "interface %s has MTU %u", ifr.ifr_name, mtu);
+	return mtu;
+}
+
+// Applies packet size and delay. The packet size includes the IP/UDP/GVSP headers, so it can be
+// as large as the MTU. Cameras reject sizes above their own maximum, so the probe steps down.
+static void
+gst_dalsa_src_configure_packets (GstDalsaSrc * src)
+{
+	int type;
+	UINT32 val = 0;
+
+	if (src->auto_packet_size) {
+		static const guint sizes[] = { 8192, 6000, 4096, 3000, 1500 };
+		guint mtu = gst_dalsa_src_probe_mtu (src);
+
+		val = mtu & ~3u;
+		if (mtu > 0 && GevSetFeatureValue (src->camHandle, "GevSCPSPacketSize", sizeof(UINT32), &val) != 0) {
+			for (int i = 0; i < G_N_ELEMENTS (sizes); i++) {
+				if (sizes[i] >= mtu)
+					continue;
+				val = sizes[i];
+				if (GevSetFeatureValue (src->camHandle, "GevSCPSPacketSize", sizeof(UINT32), &val) == 0)
+					break;
+			}
+		}
+	} else if (src->packet_size > 0) {
+		val = src->packet_size;
+		if (GevSetFeatureValue (src->camHandle, "GevSCPSPacketSize", sizeof(UINT32), &val) != 0)
+			GST_WARNING_OBJECT (src, "camera rejected packet size %u", val);
+	}
+
+	GevGetFeatureValue (src->camHandle, "GevSCPSPacketSize", &type, sizeof(UINT32), &val);
+	src->effective_packet_size = (val > GVSP_PACKET_OVERHEAD) ? val : 1500;
+	GST_INFO_OBJECT (src, "stream packet size %u", src->effective_packet_size);
+
+	if (!src->bandwidth_budget && src->packet_delay >= 0) {
+		val = src->packet_delay;
+		if (GevSetFeatureValue (src->camHandle, "GevSCPD", sizeof(UINT32), &val) != 0)
+			GST_WARNING_OBJECT (src, "could not set packet delay");
+	}
+}
+
+// Bits per second on the wire for one payload of payload_size at the camera frame rate
+static gdouble
+gst_dalsa_src_bandwidth_demand (GstDalsaSrc * src, UINT64 payload_size)
+{
+	int type;
+	float fps = 0.0f;
+	guint packet_payload = src->effective_packet_size - GVSP_PACKET_OVERHEAD;
+	guint64 packets;
+
+	if (GevGetFeatureValue (src->camHandle, "AcquisitionFrameRate", &type, sizeof(float), &fps) != 0 || fps <= 0.0f)
+		fps = src->framerate;
+	packets = (payload_size + packet_payload - 1) / packet_payload;
+
+	return (payload_size + packets * (GVSP_PACKET_OVERHEAD + ETHERNET_OVERHEAD)) * 8.0 * fps;
+}
+
+//=====================================================================================
+// Preview pad
+//
+// The downscale is accumulated row by row while the main frame is copied, so every source
+// row is read once while it is still in cache instead of being re-read by a videoscale.
+
+// Sends the sticky events the preview pad needs before its first buffer or EOS
+static void
+gst_dalsa_src_preview_send_events (GstDalsaSrc * src)
+{
+	gchar *stream_id;
+	GstCaps *caps;
+	GstSegment segment;
+
+	if (!src->preview_need_events)
+		return;
+
+	stream_id = gst_pad_create_stream_id (src->preview_pad, GST_ELEMENT (src), "preview");
+	gst_pad_push_event (src->preview_pad, gst_event_new_stream_start (stream_id));
+	g_free (stream_id);
+	caps = gst_video_info_to_caps (&src->preview_info);
+	gst_pad_push_event (src->preview_pad, gst_event_new_caps (caps));
+	gst_caps_unref (caps);
+	gst_segment_init (&segment, GST_FORMAT_TIME);
+	gst_pad_push_event (src->preview_pad, gst_event_new_segment (&segment));
+	src->preview_need_events = FALSE;
+}
+
+// basesrc only sends EOS and flushes on its own pad, so mirror them on the preview pad
+static GstPadProbeReturn
+gst_dalsa_src_preview_event_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+	GstDalsaSrc *src = GST_DALSA_SRC (user_data);
+	GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+	switch (GST_EVENT_TYPE (event)) {
+	case GST_EVENT_EOS:
+		gst_dalsa_src_preview_send_events (src);
+		gst_pad_push_event (src->preview_pad, gst_event_ref (event));
+		break;
+	case GST_EVENT_FLUSH_START:
+		gst_pad_push_event (src->preview_pad, gst_event_ref (event));
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		gst_pad_push_event (src->preview_pad, gst_event_ref (event));
+		// flush-stop clears the sticky segment, send it again with the next preview
+		src->preview_need_events = TRUE;
+		break;
+	default:
+		break;
+	}
+
+	return GST_PAD_PROBE_OK;
+}
+
+static void
+gst_dalsa_src_preview_add_pad (GstDalsaSrc * src)
+{
+	GstElementClass *klass = GST_ELEMENT_GET_CLASS (src);
+	guint pw = src->width / src->preview_scale;
+	guint ph = src->height / src->preview_scale;
+	GstStructure *config;
+	GstCaps *caps;
+
+	gst_video_info_set_format (&src->preview_info, GST_VIDEO_FORMAT_GRAY8, pw, ph);
+	src->preview_acc = g_new0 (guint16, pw);
+	src->preview_need_events = TRUE;
+
+	// Preview buffers are recycled like the main ones instead of allocated per frame
+	caps = gst_video_info_to_caps (&src->preview_info);
+	src->preview_pool = gst_video_buffer_pool_new ();
+	config = gst_buffer_pool_get_config (src->preview_pool);
+	gst_buffer_pool_config_set_params (config, caps, GST_VIDEO_INFO_SIZE (&src->preview_info), PREVIEW_POOL_MIN, 0);
+	gst_caps_unref (caps);
+	if (!gst_buffer_pool_set_config (src->preview_pool, config) ||
+			!gst_buffer_pool_set_active (src->preview_pool, TRUE))
+		GST_WARNING_OBJECT (src, "could not set up the preview buffer pool, no previews will be pushed");
+
+	src->preview_pad = gst_pad_new_from_template (
+			gst_element_class_get_pad_template (klass, "preview"), "preview");
+	gst_pad_use_fixed_caps (src->preview_pad);
+	gst_pad_set_active (src->preview_pad, TRUE);
+	gst_element_add_pad (GST_ELEMENT (src), src->preview_pad);
+	gst_element_no_more_pads (GST_ELEMENT (src));
+
+	src->preview_probe = gst_pad_add_probe (GST_BASE_SRC_PAD (src),
+			GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+			gst_dalsa_src_preview_event_probe, src, NULL);
+}
+
+static void
+gst_dalsa_src_preview_remove_pad (GstDalsaSrc * src)
+{
+	if (src->preview_probe != 0) {
+		gst_pad_remove_probe (GST_BASE_SRC_PAD (src), src->preview_probe);
+		src->preview_probe = 0;
+	}
+	if (src->preview_pad != NULL) {
+		gst_pad_set_active (src->preview_pad, FALSE);
+		gst_element_remove_pad (GST_ELEMENT (src), src->preview_pad);
+		src->preview_pad = NULL;
+	}
+	if (src->preview_pool != NULL) {
+		gst_buffer_pool_set_active (src->preview_pool, FALSE);
+		gst_object_unref (src->preview_pool);
+		src->preview_pool = NULL;
+	}
+	g_free (src->preview_acc);
+	src->preview_acc = NULL;
+}
+
+// Adds one source row into the column sums; every preview_scale rows the averaged row is written to dst.
+static inline void
+gst_dalsa_src_preview_row (GstDalsaSrc * src, const guint8 * row, guint y, guint8 * dst, gint dst_stride)
+{
+	const guint f = src->preview_scale;
+	const guint pw = GST_VIDEO_INFO_WIDTH (&src->preview_info);
+	const guint shift = (f == 2) ? 2 : (f == 4) ? 4 : 6;  // log2 (f * f)
+	guint16 *acc = src->preview_acc;
+
+	if (y / f >= GST_VIDEO_INFO_HEIGHT (&src->preview_info))
+		return;
+
+	for (guint x = 0; x < pw; x++) {
+		const guint8 *p = row + x * f;
+		guint sum = 0;
+
+		for (guint k = 0; k < f; k++)
+			sum += p[k];
+		acc[x] += sum;
+	}
+
+	if (y % f == f - 1) {
+		guint8 *out = dst + (y / f) * dst_stride;
+
+		for (guint x = 0; x < pw; x++) {
+			out[x] = (acc[x] + (1 << (shift - 1))) >> shift;
+			acc[x] = 0;
+		}
+	}
+}
+
+static void
+gst_dalsa_src_preview_push (GstDalsaSrc * src, GstBuffer * pbuf, GstBuffer * main_buf)
+{
+	GstFlowReturn ret;
+
+	gst_dalsa_src_preview_send_events (src);
+
+	GST_BUFFER_PTS (pbuf) = GST_BUFFER_PTS (main_buf);
+	GST_BUFFER_DTS (pbuf) = GST_BUFFER_DTS (main_buf);
+	GST_BUFFER_DURATION (pbuf) = GST_BUFFER_DURATION (main_buf) * src->preview_interval;
+	if (gst_base_src_get_do_timestamp (GST_BASE_SRC (src))) {
+		// basesrc only stamps the main buffer after create() returns, so take the same running time here
+		GstClock *clock = gst_element_get_clock (GST_ELEMENT (src));
+
+		if (clock != NULL) {
+			GST_BUFFER_PTS (pbuf) = gst_clock_get_time (clock) - gst_element_get_base_time (GST_ELEMENT (src));
+			gst_object_unref (clock);
+		}
+	}
+
+	ret = gst_pad_push (src->preview_pad, pbuf);
+	if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
+		GST_DEBUG_OBJECT (src, "preview push returned %s", gst_flow_get_name (ret));
+}
+
+//=====================================================================================
+// Frame accumulation
+//
+// Frames are summed straight from the GEV buffers into a 16-bit accumulator (256 * 255 fits),
+// so no source frame is ever copied into a GstBuffer. The inner loops are plain widening
+// adds over contiguous rows and a 16-bit multiply-high for the average, which the
+// compiler vectorizes with the flags set in meson.build.
+
+static GstVideoFormat
+gst_dalsa_src_output_format (GstDalsaSrc * src)
+{
+	if (src->accumulate > 1 && src->accumulate_output == GST_ACCUMULATE_SUM)
+		return GST_VIDEO_FORMAT_GRAY16_LE;
+	return DEFAULT_GST_VIDEO_FORMAT;
+}
+
+// The sliding window keeps 'accumulate' raw frames, which can be hundreds of MB, so a failed
+// allocation is reported instead of aborting the process. Returns FALSE with nothing allocated.
+static gboolean
+gst_dalsa_src_accumulate_alloc (GstDalsaSrc * src)
+{
+	gsize pixels = (gsize) src->width * src->height;
+
+	src->acc = g_try_new0 (guint16, pixels);
+	if (src->acc == NULL)
+		return FALSE;
+	// With v = sum + n/2, v * floor(2^16 / n) >> 16 is v / n or one less, so a single
+	// remainder check gives round(sum / n) exactly, all in 16 bit lanes
+	src->acc_recip = (1u << 16) / src->accumulate;
+	if (src->accumulate_sliding) {
+		src->acc_history = g_try_malloc (pixels * src->accumulate);
+		if (src->acc_history == NULL) {
+			g_free (src->acc);
+			src->acc = NULL;
+			return FALSE;
+		}
+	}
+	src->acc_count = 0;
+	src->acc_pos = 0;
+
+	return TRUE;
+}
+
+static void
+gst_dalsa_src_accumulate_free (GstDalsaSrc * src)
+{
+	g_free (src->acc);
+	src->acc = NULL;
+	g_free (src->acc_history);
+	src->acc_history = NULL;
+}
+
+// Adds img to the accumulator. Returns TRUE when an output frame is due.
+static gboolean
+gst_dalsa_src_accumulate_frame (GstDalsaSrc * src, GEV_BUFFER_OBJECT * img)
+{
+	const guint w = src->width;
+	const gboolean full = src->accumulate_sliding && src->acc_count == src->accumulate;
+	guint8 *slot = src->accumulate_sliding ?
+			src->acc_history + (gsize) src->acc_pos * w * src->height : NULL;
+
+	for (guint y = 0; y < src->height; y++) {
+		const guint8 * restrict in = img->address + y * src->pitch;
+		guint16 * restrict a = src->acc + (gsize) y * w;
+
+		if (full) {
+			// Drop the oldest frame of the window; wrap-around in 16 bits cancels out
+			guint8 * restrict old = slot + (gsize) y * w;
+
+			for (guint x = 0; x < w; x++)
+				a[x] += in[x] - old[x];
+		} else {
+			for (guint x = 0; x < w; x++)
+				a[x] += in[x];
+		}
+		if (slot != NULL)
+			memcpy (slot + (gsize) y * w, in, w);
+	}
+
+	if (src->accumulate_sliding) {
+		src->acc_pos = (src->acc_pos + 1) % src->accumulate;
+		if (src->acc_count < src->accumulate)
+			src->acc_count++;
+		return src->acc_count == src->accumulate;
+	}
+
+	if (++src->acc_count < src->accumulate)
+		return FALSE;
+	src->acc_count = 0;
+	return TRUE;
+}
+
+// Writes the accumulated frame to dst and, for block mode, clears the accumulator.
+// In average mode each output row also feeds the preview when pdst is set.
+static void
+gst_dalsa_src_accumulate_output (GstDalsaSrc * src, guint8 * dst, gint dst_stride, guint8 * pdst)
+{
+	const guint w = src->width;
+	const guint16 recip = src->acc_recip;
+	const guint16 n = src->accumulate;
+	const guint16 half = n / 2;
+
+	for (guint y = 0; y < src->height; y++) {
+		guint16 * restrict a = src->acc + (gsize) y * w;
+
+		if (src->accumulate_output == GST_ACCUMULATE_SUM) {
+			guint16 * restrict out = (guint16 *) (dst + y * dst_stride);
+
+			for (guint x = 0; x < w; x++)
+				out[x] = GUINT16_TO_LE (a[x]);
+		} else {
+			guint8 * restrict out = dst + y * dst_stride;
+
+			for (guint x = 0; x < w; x++) {
+				guint16 v = a[x] + half;
+				guint16 q = ((guint32) v * recip) >> 16;
+				guint16 r = v - q * n;
+
+				out[x] = (guint8) (q + (r >= n));
+			}
+			if (pdst != NULL)
+				gst_dalsa_src_preview_row (src, out, y, pdst, GST_VIDEO_INFO_PLANE_STRIDE (&src->preview_info, 0));
+		}
+		if (!src->accumulate_sliding)
+			memset (a, 0, w * sizeof (guint16));
+	}
+}
+
+//=====================================================================================
+// Shared acquisition
+//
+// In the default mode every dalsasrc parks its streaming thread in GevWaitForNextImage().
+// In shared mode a few workers call into the library for all cameras of the process, queue
+// ready images on the element and wake its streaming thread through an eventfd. The eventfd
+// lets unlock() wake a waiting create() immediately. This is not a scalability gain: every
+// element still has its streaming thread, now blocked in poll(), the workers come on top,
+// and each frame takes one more thread hop than in wait mode.
+//
+// The GigeV C API has no frame-ready callback and GevWaitForNextImage() blocks on a single
+// camera, so a worker first collects whatever its cameras have ready without blocking, then
+// parks in the library on one of them for up to ACQ_WORKER_WAIT_MS, taking turns. A worker
+// with a single camera is therefore a plain blocking wait (the timeout only bounds how long
+// leave() waits); with several, a frame on a camera the worker is not parked on waits at
+// most ACQ_WORKER_WAIT_MS. Each worker has its own lock and camera list and only holds the
+// lock to copy the list; cameras in use are pinned so leave() waits for the current pass
+// instead of closing a camera under the worker.
+
+typedef struct
+{
+	GThread *thread;
+	GMutex lock;                // protects members, running and the acq_pins of the members
+	GCond cond;                 // signalled when members, running or a pin count change
+	GList *members;
+	gboolean running;
+	guint64 waits;              // blocking waits in the library, only touched by the worker
+	guint64 images;             // images queued, only touched by the worker
+} GstDalsaAcqWorker;
+
+// acq_pool guards the pool layout (start/stop, assignment); the workers never take it
+G_LOCK_DEFINE_STATIC (acq_pool);
+static GstDalsaAcqWorker acq_workers[MAX_ACQ_WORKERS];
+static guint acq_worker_load[MAX_ACQ_WORKERS];
+static guint acq_n_workers = 0;
+static guint acq_n_members = 0;
+
+static void
+gst_dalsa_src_wake (GstDalsaSrc * src)
+{
+	guint64 one = 1;
+
+	if (src->event_fd >= 0 && write (src->event_fd, &one, sizeof(one)) != sizeof(one))
+		GST_LOG_OBJECT (src, "eventfd write failed");
+}
+
+// Queues a ready image for the streaming thread. If it is not keeping up the oldest image
+// is dropped, since the library will soon reuse its buffer.
+static void
+gst_dalsa_src_acq_enqueue (GstDalsaSrc * src, GEV_BUFFER_OBJECT * img)
+{
+	g_mutex_lock (&src->acq_lock);
+	if (src->acq_len == ACQ_QUEUE_LEN) {
+		src->acq_head = (src->acq_head + 1) % ACQ_QUEUE_LEN;
+		src->acq_len--;
+		src->acq_overrun++;
+		g_atomic_int_inc (&src->frames_overrun);
+	}
+	src->acq_queue[(src->acq_head + src->acq_len) % ACQ_QUEUE_LEN] = img;
+	src->acq_len++;
+	g_mutex_unlock (&src->acq_lock);
+
+	gst_dalsa_src_wake (src);
+}
+
+static gpointer
+gst_dalsa_acq_worker (gpointer data)
+{
+	GstDalsaAcqWorker *worker = data;
+	GstDalsaSrc *cams[MAX_CAMERAS];
+	guint next = 0;
+
+	g_mutex_lock (&worker->lock);
+	while (worker->running) {
+		GEV_BUFFER_OBJECT *img = NULL;
+		gboolean found = FALSE;
+		guint n = 0;
+
+		if (worker->members == NULL) {
+			g_cond_wait (&worker->cond, &worker->lock);
+			continue;
+		}
+		for (GList *l = worker->members; l != NULL && n < MAX_CAMERAS; l = l->next) {
+			cams[n] = l->data;
+			cams[n]->acq_pins++;
+			n++;
+		}
+		g_mutex_unlock (&worker->lock);
+
+		for (guint i = 0; i < n; i++) {
+			while (GevWaitForNextImage (cams[i]->camHandle, &img, 0) == GEVLIB_OK && img != NULL) {
+				gst_dalsa_src_acq_enqueue (cams[i], img);
+				img = NULL;
+				found = TRUE;
+				worker->images++;
+			}
+		}
+		if (!found) {
+			next = (next + 1) % n;
+			worker->waits++;
+			if (GevWaitForNextImage (cams[next]->camHandle, &img,
+					(n == 1) ? ACQ_WORKER_PARK_MS : ACQ_WORKER_WAIT_MS) == GEVLIB_OK && img != NULL) {
+				gst_dalsa_src_acq_enqueue (cams[next], img);
+				worker->images++;
+			}
+		}
+
+		g_mutex_lock (&worker->lock);
+		for (guint i = 0; i < n; i++)
+			cams[i]->acq_pins--;
+		g_cond_broadcast (&worker->cond);
+	}
+	g_mutex_unlock (&worker->lock);
+
+	return NULL;
+}
+
+static void
+gst_dalsa_acq_join (GstDalsaSrc * src)
+{
+	GstDalsaAcqWorker *worker;
+	guint best = 0;
+
+	G_LOCK (acq_pool);
+	if (acq_n_workers == 0) {
+		acq_n_workers = src->acquisition_workers;
+		for (guint i = 0; i < acq_n_workers; i++) {
+			worker = &acq_workers[i];
+			acq_worker_load[i] = 0;
+			worker->members = NULL;
+			worker->running = TRUE;
+			worker->waits = 0;
+			worker->images = 0;
+			worker->thread = g_thread_new ("dalsa-acq", gst_dalsa_acq_worker, worker);
+		}
+	}
+	for (guint i = 1; i < acq_n_workers; i++) {
+		if (acq_worker_load[i] < acq_worker_load[best])
+			best = i;
+	}
+	src->acq_worker = best;
+	src->acq_pins = 0;
+	acq_worker_load[best]++;
+	acq_n_members++;
+
+	worker = &acq_workers[best];
+	g_mutex_lock (&worker->lock);
+	worker->members = g_list_prepend (worker->members, src);
+	g_cond_broadcast (&worker->cond);
+	g_mutex_unlock (&worker->lock);
+	G_UNLOCK (acq_pool);
+
+	GST_DEBUG_OBJECT (src, "joined acquisition worker %u", best);
+}
+
+static void
+gst_dalsa_acq_leave (GstDalsaSrc * src)
+{
+	GstDalsaAcqWorker *worker;
+	gboolean member;
+
+	G_LOCK (acq_pool);
+	if (acq_n_workers == 0 || src->acq_worker >= acq_n_workers) {
+		G_UNLOCK (acq_pool);
+		return;
+	}
+	worker = &acq_workers[src->acq_worker];
+	g_mutex_lock (&worker->lock);
+	member = g_list_find (worker->members, src) != NULL;
+	if (member) {
+		worker->members = g_list_remove (worker->members, src);
+		// The worker may be in the middle of a pass over this camera
+		while (src->acq_pins > 0)
+			g_cond_wait (&worker->cond, &worker->lock);
+	}
+	g_mutex_unlock (&worker->lock);
+	if (!member) {
+		G_UNLOCK (acq_pool);
+		return;
+	}
+	acq_worker_load[src->acq_worker]--;
+
+	if (--acq_n_members == 0) {
+		// Last camera gone, stop the pool. The workers never take acq_pool, so joining here is safe.
+		for (guint i = 0; i < acq_n_workers; i++) {
+			worker = &acq_workers[i];
+			g_mutex_lock (&worker->lock);
+			worker->running = FALSE;
+			g_cond_broadcast (&worker->cond);
+			g_mutex_unlock (&worker->lock);
+			g_thread_join (worker->thread);
+			worker->thread = NULL;
+			GST_DEBUG ("acquisition worker %u: %" G_GUINT64_FORMAT " waits, %" G_GUINT64_FORMAT " images",
+					i, worker->waits, worker->images);
+		}
+		acq_n_workers = 0;
+	}
+	G_UNLOCK (acq_pool);
+}
+
+// Gets the next image, either from the library or from the shared pool queue. overrun is set to
+// the number of images the queue dropped before this one. Returns FALSE on timeout or when
+// unlock() was called.
+static gboolean
+gst_dalsa_src_wait_image (GstDalsaSrc * src, GEV_BUFFER_OBJECT ** img, guint * overrun)
+{
+	struct pollfd pfd;
+	guint64 count;
+
+	*img = NULL;
+	*overrun = 0;
+	if (!src->acq_shared)
+		return GevWaitForNextImage (src->camHandle, img, ACQ_WAIT_TIMEOUT_MS) == GEVLIB_OK && *img != NULL;
+
+	pfd.fd = src->event_fd;
+	pfd.events = POLLIN;
+	for (;;) {
+		g_mutex_lock (&src->acq_lock);
+		if (src->acq_len > 0) {
+			*img = src->acq_queue[src->acq_head];
+			src->acq_head = (src->acq_head + 1) % ACQ_QUEUE_LEN;
+			src->acq_len--;
+			*overrun = src->acq_overrun;
+			src->acq_overrun = 0;
+			g_mutex_unlock (&src->acq_lock);
+			return TRUE;
+		}
+		g_mutex_unlock (&src->acq_lock);
+
+		if (src->flushing || poll (&pfd, 1, ACQ_WAIT_TIMEOUT_MS) <= 0)
+			return FALSE;
+		// Non-blocking eventfd: just reset the counter, the queue is the source of truth
+		if (read (src->event_fd, &count, sizeof(count)) < 0)
+			GST_LOG_OBJECT (src, "eventfd read failed");
+	}
+}
+
 //queries camera devices and begins acquisition
 static gboolean
 gst_dalsa_src_start (GstBaseSrc * bsrc)
@@ -428,6 +1660,15 @@ gst_dalsa_src_start (GstBaseSrc * bsrc)
 				GevGetFeatureValue(src->camHandle, "Width", &type, sizeof(width), &width);
 				GevGetFeatureValue(src->camHandle, "Height", &type, sizeof(height), &height);
 				GevGetFeatureValue(src->camHandle, "PixelFormat", &type, sizeof(format), &format);
+
+				// Caps are built from these, so they have to match what the camera sends
+				if (width > 0 && height > 0)
+				{
+					src->width = width;
+					src->height = height;
+					src->pitch = src->width * src->bytesPerPixel;
+					src->gst_stride = src->pitch;
+				}
 			}
 			else{
 				GST_ERROR_OBJECT(src, "Could not open camera %d with status %#06x", src->cameraID, status);
@@ -436,6 +1677,14 @@ gst_dalsa_src_start (GstBaseSrc * bsrc)
 			// Get the low part of the MAC address (use it as part of a unique file name for saving images).
 			// Generate a unique base name to be used for saving image files
 			// based on the last 3 octets of the MAC address.
+			// Remember the host interface for the MTU probe and bandwidth budget
+			src->if_index = pCamera[src->cameraID].host.ifIndex;
+			for (i = 0; src->cameraIP > 0 && i < numCamera; i++)
+			{
+				if (pCamera[i].ipAddr == src->cameraIP)
+					src->if_index = pCamera[i].host.ifIndex;
+			}
+
 			macLow = pCamera[src->cameraID].macLow;
 			macLow &= 0x00FFFFFF;
 			snprintf(uniqueName, sizeof(uniqueName), "img_%06x", macLow); 
@@ -450,6 +1699,14 @@ gst_dalsa_src_start (GstBaseSrc * bsrc)
 				GevGetCameraInterfaceOptions( src->camHandle, &camOptions);
 				//camOptions.heartbeat_timeout_ms = 60000;		// For debugging (delay camera timeout while in debugger)
 				camOptions.heartbeat_timeout_ms = 5000;		// Disconnect detection (5 seconds)
+				if (src->packet_resends >= 0)
+					camOptions.streamMaxPacketResends = src->packet_resends;
+				if (src->stream_thread_affinity >= 0)
+					camOptions.streamThreadAffinity = src->stream_thread_affinity;
+				if (src->stream_memory_limit > 0)
+					camOptions.streamMemoryLimitMax = src->stream_memory_limit;
+				if (src->incomplete_policy == GST_INCOMPLETE_WAIT && src->resend_timeout > 0)
+					camOptions.streamFrame_timeout_ms = src->resend_timeout;
 				// Write the adjusted interface options back.
 				GevSetCameraInterfaceOptions( src->camHandle, &camOptions);
 
@@ -475,13 +1732,64 @@ gst_dalsa_src_start (GstBaseSrc * bsrc)
 					printf("PixelFormat (val) = 0x%x\n", val);
 				}
 
+				// Chunk data changes the payload size, so it must be enabled before the transfer is set up.
+				if (src->chunk_mode)
+				{
+					UINT32 val = 1;
+
+					if (GevSetFeatureValue( src->camHandle, "ChunkModeActive", sizeof(UINT32), &val) != 0)
+						GST_WARNING_OBJECT (src, "camera does not support chunk mode");
+					for (guint c = 0; c < src->n_chunk_map; c++)
+					{
+						if (GevSetFeatureValueAsString( src->camHandle, "ChunkSelector", src->chunk_map[c].selector) != 0 ||
+							GevSetFeatureValue( src->camHandle, "ChunkEnable", sizeof(UINT32), &val) != 0)
+							GST_WARNING_OBJECT (src, "could not enable chunk %s", src->chunk_map[c].selector);
+					}
+				}
+
+				// TurboDrive has to be decided after the pixel format is set, since availability depends on it.
+				src->turbo_drive_active = FALSE;
+				if (src->turbo_drive)
+				{
+					UINT32 val = 1;
+
+					turboDriveAvailable = gst_dalsa_src_turbo_drive_available (src);
+					if (turboDriveAvailable && GevSetFeatureValue( src->camHandle, "transferTurboMode", sizeof(UINT32), &val) == 0)
+					{
+						src->turbo_drive_active = TRUE;
+						GST_INFO_OBJECT (src, "TurboDrive enabled");
+					}
+					else
+					{
+						GST_WARNING_OBJECT (src, "TurboDrive requested but not available for this camera/pixel format");
+					}
+				}
+				if (!src->turbo_drive_active)
+				{
+					// The mode persists on the camera, so clear it in case an earlier session left it on.
+					// Cameras without TurboDrive reject the feature, which is fine.
+					UINT32 val = 0;
+
+					GevSetFeatureValue( src->camHandle, "transferTurboMode", sizeof(UINT32), &val);
+				}
+
 
 				if (status == 0)
 				{
 					//=================================================================
 					// Set up a grab/transfer from this camera
 					//
+					gst_dalsa_src_configure_packets (src);
 					GevGetPayloadParameters( src->camHandle,  &payload_size, (UINT32 *)&type);
+					if (src->bandwidth_budget)
+					{
+						UINT64 tick_frequency = 0;
+
+						GevGetFeatureValue( src->camHandle, "GevTimestampTickFrequency", &type, sizeof(UINT64), &tick_frequency);
+						src->tick_frequency = (tick_frequency > 0) ? tick_frequency : 1000000000;
+						src->bandwidth_demand = gst_dalsa_src_bandwidth_demand (src, payload_size);
+						gst_dalsa_bandwidth_join (src);
+					}
 					maxHeight = height;
 					maxWidth = width;
 					maxDepth = GetPixelSizeInBytes(format);
@@ -513,8 +1821,42 @@ gst_dalsa_src_start (GstBaseSrc * bsrc)
 					{
 						memset(src->bufAddress[i], 0, size);
 					}
+					if (src->preview_scale > 0)
+						gst_dalsa_src_preview_add_pad (src);
+					if (src->accumulate > 1 && !gst_dalsa_src_accumulate_alloc (src))
+					{
+						GST_ELEMENT_ERROR (src, RESOURCE, NO_SPACE_LEFT, ("Not enough memory for frame accumulation"),
+								("could not allocate %u frames of %ux%u", src->accumulate_sliding ? src->accumulate : 1,
+								src->width, src->height));
+						gst_dalsa_bandwidth_leave (src);
+						gst_dalsa_src_preview_remove_pad (src);
+						return FALSE;
+					}
+
 					status = GevStartTransfer( src->camHandle, -1);
-					if (status != 0) return FALSE; 
+					if (status != 0)
+					{
+						// basesrc does not call stop() after a failed start
+						gst_dalsa_bandwidth_leave (src);
+						gst_dalsa_src_preview_remove_pad (src);
+						gst_dalsa_src_accumulate_free (src);
+						return FALSE;
+					}
+
+					src->acq_shared = FALSE;
+					if (src->acquisition_mode == GST_ACQUISITION_SHARED)
+					{
+						src->event_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+						if (src->event_fd < 0)
+						{
+							GST_WARNING_OBJECT (src, "eventfd failed, falling back to waiting in the library");
+						}
+						else
+						{
+							src->acq_shared = TRUE;
+							gst_dalsa_acq_join (src);
+						}
+					}
 				}
 			}
 	}
@@ -535,6 +1877,13 @@ gst_dalsa_src_stop (GstBaseSrc * bsrc)
 	GstDalsaSrc *src = GST_DALSA_SRC (bsrc);
 
 	GST_DEBUG_OBJECT (src, "stop");
+	gst_dalsa_acq_leave (src);
+	if (src->event_fd >= 0)
+	{
+		close (src->event_fd);
+		src->event_fd = -1;
+	}
+	gst_dalsa_bandwidth_leave (src);
 	GevStopTransfer(src->camHandle);
 
 	GevAbortTransfer(src->camHandle); 
@@ -547,6 +1896,8 @@ gst_dalsa_src_stop (GstBaseSrc * bsrc)
 	}
 
 	GevCloseCamera(&src->camHandle);
+	gst_dalsa_src_preview_remove_pad (src);
+	gst_dalsa_src_accumulate_free (src);
 	gst_dalsa_src_reset (src);
 	// Close down the API.
 	GevApiUninitialize();
@@ -574,7 +1925,7 @@ gst_dalsa_src_get_caps (GstBaseSrc * bsrc, GstCaps * filter)
 	vinfo.fps_n = 0; //0 means variable FPS
 	vinfo.fps_d = 1;
 	vinfo.interlace_mode = GST_VIDEO_INTERLACE_MODE_PROGRESSIVE;
-	vinfo.finfo = gst_video_format_get_info(DEFAULT_GST_VIDEO_FORMAT);
+	vinfo.finfo = gst_video_format_get_info(gst_dalsa_src_output_format (src));
   
 	caps = gst_video_info_to_caps(&vinfo);
 
@@ -591,6 +1942,9 @@ gst_dalsa_src_set_caps (GstBaseSrc * bsrc, GstCaps * caps)
 
 	//Currently using fixed caps
 	GST_DEBUG_OBJECT (src, "The caps being set are %" GST_PTR_FORMAT, caps);
+	if (!gst_video_info_from_caps (&vinfo, caps))
+		goto unsupported_caps;
+	src->vinfo = vinfo;
 	src->acq_started = TRUE;
 
 	return TRUE;
@@ -603,36 +1957,288 @@ gst_dalsa_src_set_caps (GstBaseSrc * bsrc, GstCaps * caps)
 	return FALSE;
 }
 
+// Configures the buffer pool create() draws from. A pool proposed by downstream (encoder, appsink, ...)
+// is used as is so frames land in their final destination; otherwise a GstVideoBufferPool is made.
+// Rows are only padded for alignment when downstream can read the strides from GstVideoMeta.
+// The allocator and allocation params from the query are applied like the base class does.
+static gboolean
+gst_dalsa_src_decide_allocation (GstBaseSrc * bsrc, GstQuery * query)
+{
+	GstDalsaSrc *src = GST_DALSA_SRC (bsrc);
+	GstBufferPool *pool = NULL;
+	GstAllocator *allocator = NULL;
+	GstAllocationParams params;
+	GstStructure *config;
+	GstCaps *caps;
+	GstVideoInfo vinfo;
+	guint size = 0, min = 0, max = 0;
+	gboolean update, update_allocator;
+
+	gst_query_parse_allocation (query, &caps, NULL);
+	if (caps == NULL || !gst_video_info_from_caps (&vinfo, caps))
+		return FALSE;
+
+	update_allocator = gst_query_get_n_allocation_params (query) > 0;
+	if (update_allocator)
+		gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+	else
+		gst_allocation_params_init (&params);
+
+	update = gst_query_get_n_allocation_pools (query) > 0;
+	if (update)
+		gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+
+	if (pool == NULL) {
+		GST_DEBUG_OBJECT (src, "no downstream pool, creating a video buffer pool");
+		pool = gst_video_buffer_pool_new ();
+	}
+	size = MAX (size, vinfo.size);
+	min = MAX (min, 2);
+
+	config = gst_buffer_pool_get_config (pool);
+	gst_buffer_pool_config_set_params (config, caps, size, min, max);
+	gst_buffer_pool_config_set_allocator (config, allocator, &params);
+	if (gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL)) {
+		gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+		if (gst_buffer_pool_has_option (pool, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+			GstVideoAlignment align;
+
+			gst_video_alignment_reset (&align);
+			align.stride_align[0] = POOL_STRIDE_ALIGN;
+			gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+			gst_buffer_pool_config_set_video_alignment (config, &align);
+		}
+	}
+
+	if (!gst_buffer_pool_set_config (pool, config)) {
+		// The pool may have adjusted the parameters, accept them if they still fit the caps
+		config = gst_buffer_pool_get_config (pool);
+		if (!gst_buffer_pool_config_validate_params (config, caps, size, min, max)
+				|| !gst_buffer_pool_set_config (pool, config)) {
+			GST_ERROR_OBJECT (src, "failed to configure buffer pool");
+			gst_object_unref (pool);
+			if (allocator != NULL)
+				gst_object_unref (allocator);
+			return FALSE;
+		}
+	}
+
+	if (update_allocator)
+		gst_query_set_nth_allocation_param (query, 0, allocator, &params);
+	else
+		gst_query_add_allocation_param (query, allocator, &params);
+	if (allocator != NULL)
+		gst_object_unref (allocator);
+
+	if (update)
+		gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+	else
+		gst_query_add_allocation_pool (query, pool, size, min, max);
+	gst_object_unref (pool);
+
+	return TRUE;
+}
+
+// Wakes a create() blocked waiting for an image so the element can flush or stop
+static gboolean
+gst_dalsa_src_unlock (GstBaseSrc * bsrc)
+{
+	GstDalsaSrc *src = GST_DALSA_SRC (bsrc);
+
+	GST_DEBUG_OBJECT (src, "unlock");
+	src->flushing = TRUE;
+	gst_dalsa_src_wake (src);
+
+	return TRUE;
+}
+
+static gboolean
+gst_dalsa_src_unlock_stop (GstBaseSrc * bsrc)
+{
+	GstDalsaSrc *src = GST_DALSA_SRC (bsrc);
+
+	GST_DEBUG_OBJECT (src, "unlock stop");
+	// Images queued before the flush are stale now
+	g_mutex_lock (&src->acq_lock);
+	src->acq_head = 0;
+	src->acq_len = 0;
+	src->acq_overrun = 0;
+	g_mutex_unlock (&src->acq_lock);
+	src->flushing = FALSE;
+
+	return TRUE;
+}
+
+// Tells downstream that n frames will not come, so sync and rate control keep going.
+// Not used while accumulating since an output frame already spans several inputs.
+static void
+gst_dalsa_src_push_gap (GstDalsaSrc * src, guint64 n)
+{
+	GstClockTime frame_duration = GST_SECOND / src->framerate;
+	GstClockTime ts;
+
+	if (n == 0 || src->accumulate > 1 || src->n_frames == 0)
+		return;
+
+	if (gst_base_src_get_do_timestamp (GST_BASE_SRC (src))) {
+		// The missing frames came after the last pushed buffer, not at the current time
+		if (!GST_CLOCK_TIME_IS_VALID (src->last_running_time))
+			return;
+		ts = src->last_running_time + frame_duration;
+		src->last_running_time += n * frame_duration;
+	} else {
+		// Keep the manual timestamps in step, as if the missing frames had been pushed
+		ts = src->last_frame_time + frame_duration;
+		src->last_frame_time += n * frame_duration;
+	}
+
+	GST_DEBUG_OBJECT (src, "gap of %" G_GUINT64_FORMAT " frames at %" GST_TIME_FORMAT, n, GST_TIME_ARGS (ts));
+	gst_pad_push_event (GST_BASE_SRC_PAD (src), gst_event_new_gap (ts, n * frame_duration));
+}
+
+// Counts block IDs skipped since the previous image. GVSP 1.x block IDs are 16 bit and wrap to 1, skipping 0.
+// Any other backward jump is a camera reset or stream restart: resynchronise without counting losses.
+// overrun images were received but dropped locally, so they are skipped but not lost.
+static guint64
+gst_dalsa_src_track_block_id (GstDalsaSrc * src, GEV_BUFFER_OBJECT * img, guint overrun)
+{
+	guint64 id = img->id;
+	guint64 missing = 0;
+
+	if (src->have_block_id) {
+		if (id > src->last_block_id)
+			missing = id - src->last_block_id - 1;
+		else if (src->last_block_id <= G_MAXUINT16 && src->last_block_id > G_MAXUINT16 - BLOCK_ID_WRAP_WINDOW &&
+				id < BLOCK_ID_WRAP_WINDOW)
+			missing = (G_MAXUINT16 - src->last_block_id) + id - 1;
+		else if (id < src->last_block_id)
+			GST_INFO_OBJECT (src, "block ID went back from %" G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT
+					", resynchronising", src->last_block_id, id);
+	}
+	src->have_block_id = TRUE;
+	src->last_block_id = id;
+
+	if (missing > overrun) {
+		GST_DEBUG_OBJECT (src, "%" G_GUINT64_FORMAT " frames lost before block %" G_GUINT64_FORMAT, missing - overrun, id);
+		src->frames_lost += missing - overrun;
+	}
+	return missing;
+}
+
 //Grabs next image from camera and puts it into a gstreamer buffer
 static GstFlowReturn
 gst_dalsa_src_create (GstPushSrc * psrc, GstBuffer ** buf)
 {
 	GstDalsaSrc *src = GST_DALSA_SRC (psrc);
-	GstMapInfo minfo;
+	GstVideoFrame frame;
+	GstBufferPool *pool;
+	GstBuffer *pbuf = NULL;
+	GstMapInfo pinfo;
 
 	GEV_BUFFER_OBJECT *img = NULL;
-	GEV_STATUS status = 0;
+	guint overrun = 0;
 	gboolean test = FALSE;
 while (!test){
+	if (G_UNLIKELY (src->flushing))
+		return GST_FLOW_FLUSHING;
 	// Wait for images to be received
-	status = GevWaitForNextImage(src->camHandle, &img, 1000);
-	if ((img != NULL) && (status == GEVLIB_OK))
+	if (gst_dalsa_src_wait_image (src, &img, &overrun))
 	{	
-		if (img->status == 0)
+		gboolean complete = (img->status == 0);
+
+		gst_dalsa_src_push_gap (src, gst_dalsa_src_track_block_id (src, img, overrun));
+
+		if (!complete)
+		{
+			// Image had an error (incomplete (timeout/overflow/lost)).
+			// With the wait policy the library has already held it for resend-timeout.
+			src->frames_incomplete++;
+			if (src->incomplete_policy != GST_INCOMPLETE_PUSH_CORRUPT || src->accumulate > 1)
+			{
+				GST_DEBUG_OBJECT (src, "dropping incomplete frame %" G_GUINT64_FORMAT ", status %d", (guint64) img->id, img->status);
+				src->frames_dropped++;
+				gst_dalsa_src_push_gap (src, 1);
+				continue;
+			}
+		}
+
 		{
+			guint8 *out;
+			gint out_stride;
+
+			gst_dalsa_src_update_transfer_stats (src, img);
+
+			// In accumulation mode keep waiting until the accumulator has a frame ready
+			if (src->accumulate > 1 && !gst_dalsa_src_accumulate_frame (src, img))
+				continue;
+
 			test = TRUE;
-				// Create a new buffer for the image
-			*buf = gst_buffer_new_and_alloc (src->height * src->width * src->bytesPerPixel);
+			// Take the buffer from the negotiated pool so the frame is written once into its final destination
+			pool = gst_base_src_get_buffer_pool (GST_BASE_SRC (psrc));
+			if (pool == NULL || gst_buffer_pool_acquire_buffer (pool, buf, NULL) != GST_FLOW_OK)
+			{
+				GST_ERROR_OBJECT (src, "could not acquire a buffer from the pool");
+				if (pool != NULL)
+					gst_object_unref (pool);
+				return GST_FLOW_ERROR;
+			}
+			gst_object_unref (pool);
+
+			if (!gst_video_frame_map (&frame, &src->vinfo, *buf, GST_MAP_WRITE))
+			{
+				GST_ERROR_OBJECT (src, "could not map the output buffer");
+				gst_buffer_unref (*buf);
+				*buf = NULL;
+				return GST_FLOW_ERROR;
+			}
+			out = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+			out_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0);
+			src->gst_stride = out_stride;
 
-			gst_buffer_map (*buf, &minfo, GST_MAP_WRITE);
-			//copy image data into gstreamer buffer
-			for (int i = 0; i < src->height; i++) {
-				memcpy (minfo.data + i * src->gst_stride, img->address + i * src->pitch, src->pitch);
+			if (src->preview_pad != NULL && src->n_frames % src->preview_interval == 0 &&
+				!(src->accumulate > 1 && src->accumulate_output == GST_ACCUMULATE_SUM))
+			{
+				if (gst_buffer_pool_acquire_buffer (src->preview_pool, &pbuf, NULL) == GST_FLOW_OK)
+					gst_buffer_map (pbuf, &pinfo, GST_MAP_WRITE);
+				else
+					pbuf = NULL;
+			}
+			if (src->accumulate > 1)
+			{
+				gst_dalsa_src_accumulate_output (src, out, out_stride, pbuf != NULL ? pinfo.data : NULL);
+			}
+			else
+			{
+				//copy image data into gstreamer buffer, building the preview from the same rows
+				for (int i = 0; i < src->height; i++) {
+					memcpy (out + i * out_stride, img->address + i * src->pitch, src->pitch);
+					if (pbuf != NULL)
+						gst_dalsa_src_preview_row (src, img->address + i * src->pitch, i,
+								pinfo.data, GST_VIDEO_INFO_PLANE_STRIDE (&src->preview_info, 0));
+				}
 			}
 
-				gst_buffer_unmap (*buf, &minfo);
+			gst_video_frame_unmap (&frame);
+			if (pbuf != NULL)
+				gst_buffer_unmap (pbuf, &pinfo);
+			if (!complete)
+				GST_BUFFER_FLAG_SET (*buf, GST_BUFFER_FLAG_CORRUPTED);
+
+			if (src->chunk_mode)
+			{
+				GstDalsaChunkMeta *cmeta = gst_buffer_add_dalsa_chunk_meta (*buf);
+
+				// The GEV block ID and timestamp come with every frame; chunks may override them.
+				cmeta->frame_id = img->id;
+				cmeta->timestamp = ((guint64) img->timestamp_hi << 32) | img->timestamp_lo;
+				cmeta->fields = GST_DALSA_CHUNK_FRAME_ID | GST_DALSA_CHUNK_TIMESTAMP;
+				if (img->chunk_data != NULL && img->chunk_size > 0)
+					gst_dalsa_chunk_parse (img->chunk_data, img->chunk_size, src->chunk_map, src->n_chunk_map, cmeta);
+			}
 
 			src->duration = 1000000000.0/src->framerate; 
+			if (src->accumulate > 1 && !src->accumulate_sliding)
+				src->duration *= src->accumulate;
 			// If we do not use gst_base_src_set_do_timestamp() we need to add timestamps manually
 			src->last_frame_time += src->duration;   // Get the timestamp for this frame
 			if(!gst_base_src_get_do_timestamp(GST_BASE_SRC(psrc))){
@@ -642,10 +2248,24 @@ while (!test){
 			GST_BUFFER_DURATION(*buf) = src->duration;
 			GST_DEBUG_OBJECT(src, "pts, dts: %" GST_TIME_FORMAT ", duration: %d ms", GST_TIME_ARGS (src->last_frame_time), GST_TIME_AS_MSECONDS(src->duration));
 
+			// basesrc stamps the buffer with the running time right after create() returns
+			if (gst_base_src_get_do_timestamp (GST_BASE_SRC (psrc)))
+			{
+				GstClock *clock = gst_element_get_clock (GST_ELEMENT (src));
+
+				if (clock != NULL)
+				{
+					src->last_running_time = gst_clock_get_time (clock) - gst_element_get_base_time (GST_ELEMENT (src));
+					gst_object_unref (clock);
+				}
+			}
+
 			// count frames, and send EOS when required frame number is reached
 			GST_BUFFER_OFFSET(*buf) = src->n_frames;  // from videotestsrc
 			src->n_frames++;
 			GST_BUFFER_OFFSET_END(*buf) = src->n_frames;  // from videotestsrc
+			if (pbuf != NULL)
+				gst_dalsa_src_preview_push (src, pbuf, *buf);
 			if (psrc->parent.num_buffers>0)  // If we were asked for a specific number of buffers, stop when complete
 				if (G_UNLIKELY(src->n_frames >= psrc->parent.num_buffers))
 			return GST_FLOW_EOS;
@@ -653,13 +2273,6 @@ while (!test){
 			return GST_FLOW_OK;
 
 		}
-		else
-		{
-			GST_DEBUG_OBJECT (src, "Image Incomplete***********************!\n\n\n\n");
-			//return GST_FLOW_ERROR;
-			// Image had an error (incomplete (timeout/overflow/lost)).
-			// Do any handling of this condition necessary.
-		}
 	}
 }
 GST_DEBUG_OBJECT (src, "Capture Error!");
@@ -21,9 +21,12 @@
 #define _GST_DALSA_SRC_H_
 
 #define NUM_BUF	8
+#define ACQ_QUEUE_LEN	(NUM_BUF / 2)	// ready images held for the streaming thread in shared acquisition
 
 #include <gst/base/gstpushsrc.h>
+#include <gst/video/video.h>
 #include "gevapi.h"				//!< GEV lib definitions.
+#include "gstdalsameta.h"
 G_BEGIN_DECLS
 
 #define GST_TYPE_DALSA_SRC   (gst_dalsa_src_get_type())
@@ -50,6 +53,25 @@ typedef enum
 	GST_LUT_GAMMA
 } LUTType;
 
+typedef enum
+{
+	GST_ACCUMULATE_AVERAGE,
+	GST_ACCUMULATE_SUM
+} AccumulateOutputType;
+
+typedef enum
+{
+	GST_INCOMPLETE_DROP,
+	GST_INCOMPLETE_PUSH_CORRUPT,
+	GST_INCOMPLETE_WAIT
+} IncompletePolicyType;
+
+typedef enum
+{
+	GST_ACQUISITION_WAIT,
+	GST_ACQUISITION_SHARED
+} AcquisitionModeType;
+
 struct _GstDalsaSrc
 {
   GstPushSrc base_dalsa_src;
@@ -81,6 +103,7 @@ struct _GstDalsaSrc
   //unsigned int nRawPitch;  // because of binning the raw image size may be smaller than nHeight
 
   gint gst_stride;  // Stride/pitch for the GStreamer buffer
+  GstVideoInfo vinfo;  // negotiated output format
 
   // gst properties
   gint pixelclock;
@@ -113,12 +136,87 @@ struct _GstDalsaSrc
   gboolean gain_just_changed;
   gboolean binning_just_changed;
 
+  // transfer compression
+  gboolean turbo_drive;         // requested via property
+  gboolean turbo_drive_active;  // camera accepted transferTurboMode
+  guint link_speed;             // Mbit/s, used for the utilisation estimate
+  gdouble compression_ratio;    // image bytes / wire bytes over the last window
+  gdouble link_utilisation;     // fraction of link_speed used over the last window
+  guint64 stat_image_bytes;
+  guint64 stat_wire_bytes;      // received bytes of the images, without chunk data
+  guint64 stat_link_bytes;      // all received bytes
+  GstClockTime stat_window_start;
+
+  // transport
+  gint packet_size;             // bytes, 0 = leave the camera setting
+  gboolean auto_packet_size;    // probe the NIC MTU for jumbo frames
+  gint packet_delay;            // GevSCPD in timestamp ticks, -1 = leave the camera setting
+  gint packet_resends;          // -1 = library default
+  gint stream_thread_affinity;  // CPU for the GEV receive thread, -1 = any
+  guint stream_memory_limit;    // bytes, 0 = library default
+  gboolean bandwidth_budget;    // share link-speed with the other dalsasrc on this NIC
+  guint if_index;               // host interface the camera is attached to
+  guint effective_packet_size;
+  guint64 tick_frequency;       // camera timestamp ticks per second
+  gdouble bandwidth_demand;     // bit/s this camera needs at its frame rate
+
+  // preview
+  guint preview_scale;          // 0 = no preview pad, else 2, 4 or 8
+  guint preview_interval;       // push a preview every n-th frame
+  GstPad *preview_pad;
+  GstBufferPool *preview_pool;
+  gulong preview_probe;         // mirrors EOS and flushes from the main pad
+  GstVideoInfo preview_info;
+  guint16 *preview_acc;         // per output column sums of the current block of rows
+  gboolean preview_need_events;
+
+  // frame accumulation
+  guint accumulate;             // frames per output, 1 = off
+  AccumulateOutputType accumulate_output;
+  gboolean accumulate_sliding;  // emit on every frame, summing the last n
+  guint16 *acc;                 // width * height running sums
+  guint8 *acc_history;          // last n raw frames, only for the sliding window
+  guint16 acc_recip;            // 2^16 / accumulate, for the average
+  guint acc_count;
+  guint acc_pos;
+
+  // chunk data
+  gboolean chunk_mode;
+  gchar *chunk_ids;             // "Selector:ID,..." as set on the property
+  GstDalsaChunkMapEntry chunk_map[GST_DALSA_CHUNK_MAX];
+  guint n_chunk_map;
+
+  // frame loss
+  IncompletePolicyType incomplete_policy;
+  guint resend_timeout;         // ms the library keeps an incomplete frame open for resends
+  gboolean have_block_id;
+  guint64 last_block_id;
+  guint64 frames_lost;          // block IDs that never arrived
+  guint64 frames_incomplete;    // frames that arrived with missing packets
+  guint64 frames_dropped;       // incomplete frames not pushed downstream
+  gint frames_overrun;          // complete frames dropped from acq_queue, atomic
+
+  // acquisition
+  AcquisitionModeType acquisition_mode;
+  guint acquisition_workers;    // size of the process-wide worker pool when it is first started
+  gboolean acq_shared;          // shared acquisition in effect, FALSE when start fell back to waiting
+  guint acq_worker;             // worker serving this camera
+  guint acq_pins;               // worker passes using the camera, protected by the worker lock
+  int event_fd;                 // signalled by the worker when acq_queue gets an image
+  GMutex acq_lock;
+  GEV_BUFFER_OBJECT *acq_queue[ACQ_QUEUE_LEN];
+  guint acq_head;
+  guint acq_len;
+  guint acq_overrun;            // images dropped from acq_queue since the last dequeue
+  gboolean flushing;
+
   // stream
   gboolean acq_started;
   gint n_frames;
   gint total_timeouts;
   GstClockTime duration;
   GstClockTime last_frame_time;
+  GstClockTime last_running_time;  // running time of the last buffer pushed with do-timestamp
 
   PUINT8 bufAddress[NUM_BUF];
 };
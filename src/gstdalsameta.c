@@ -0,0 +1,225 @@
+/* GStreamer Teledyne Dalsa Plugin
+ * Copyright (C) 2021 David Thompson, Embry-Riddle Aeronautical University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Per-frame GenICam chunk data attached to buffers from dalsasrc.
+ *
+ * GigE Vision chunk payloads are a sequence of chunks, each followed by a
+ * trailer of two big-endian 32-bit words: the chunk ID and the chunk length.
+ * The parser walks the trailers from the end of the payload and copies the
+ * values it has a mapping for straight into the meta; it never allocates.
+ */
+
+#include <string.h>
+
+#include "gstdalsameta.h"
+
+static const struct
+{
+	const gchar *selector;
+	GstDalsaChunkField field;
+} chunk_fields[] = {
+	{ "ExposureTime",  GST_DALSA_CHUNK_EXPOSURE_TIME },
+	{ "Gain",          GST_DALSA_CHUNK_GAIN },
+	{ "FrameID",       GST_DALSA_CHUNK_FRAME_ID },
+	{ "LineStatusAll", GST_DALSA_CHUNK_LINE_STATUS },
+	{ "EncoderValue",  GST_DALSA_CHUNK_ENCODER_VALUE },
+	{ "Timestamp",     GST_DALSA_CHUNK_TIMESTAMP }
+};
+
+GType
+gst_dalsa_chunk_meta_api_get_type (void)
+{
+	static GType type;
+	static const gchar *tags[] = { NULL };
+
+	if (g_once_init_enter (&type)) {
+		GType _type = gst_meta_api_type_register ("GstDalsaChunkMetaAPI", tags);
+		g_once_init_leave (&type, _type);
+	}
+	return type;
+}
+
+static gboolean
+gst_dalsa_chunk_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+	GstDalsaChunkMeta *cmeta = (GstDalsaChunkMeta *) meta;
+
+	cmeta->fields = 0;
+	cmeta->exposure_time = 0.0;
+	cmeta->gain = 0.0;
+	cmeta->frame_id = 0;
+	cmeta->line_status = 0;
+	cmeta->encoder_value = 0;
+	cmeta->timestamp = 0;
+
+	return TRUE;
+}
+
+static gboolean
+gst_dalsa_chunk_meta_transform (GstBuffer * dest, GstMeta * meta,
+		GstBuffer * buffer, GQuark type, gpointer data)
+{
+	GstDalsaChunkMeta *smeta = (GstDalsaChunkMeta *) meta;
+	GstDalsaChunkMeta *dmeta;
+
+	// The values describe the whole frame, so copy them for any transform
+	dmeta = gst_buffer_add_dalsa_chunk_meta (dest);
+	if (!dmeta)
+		return FALSE;
+
+	dmeta->fields = smeta->fields;
+	dmeta->exposure_time = smeta->exposure_time;
+	dmeta->gain = smeta->gain;
+	dmeta->frame_id = smeta->frame_id;
+	dmeta->line_status = smeta->line_status;
+	dmeta->encoder_value = smeta->encoder_value;
+	dmeta->timestamp = smeta->timestamp;
+
+	return TRUE;
+}
+
+const GstMetaInfo *
+gst_dalsa_chunk_meta_get_info (void)
+{
+	static const GstMetaInfo *meta_info = NULL;
+
+	if (g_once_init_enter ((GstMetaInfo **) & meta_info)) {
+		const GstMetaInfo *mi = gst_meta_register (GST_DALSA_CHUNK_META_API_TYPE,
+				"GstDalsaChunkMeta", sizeof (GstDalsaChunkMeta),
+				gst_dalsa_chunk_meta_init, NULL, gst_dalsa_chunk_meta_transform);
+		g_once_init_leave ((GstMetaInfo **) & meta_info, (GstMetaInfo *) mi);
+	}
+	return meta_info;
+}
+
+GstDalsaChunkMeta *
+gst_buffer_add_dalsa_chunk_meta (GstBuffer * buffer)
+{
+	return (GstDalsaChunkMeta *) gst_buffer_add_meta (buffer,
+			GST_DALSA_CHUNK_META_INFO, NULL);
+}
+
+// Fills in a map entry for a ChunkSelector name. Returns FALSE for selectors the meta has no field for.
+gboolean
+gst_dalsa_chunk_map_entry_init (GstDalsaChunkMapEntry * entry,
+		const gchar * selector, guint32 id)
+{
+	for (guint i = 0; i < G_N_ELEMENTS (chunk_fields); i++) {
+		if (g_strcmp0 (selector, chunk_fields[i].selector) == 0) {
+			g_strlcpy (entry->selector, selector, sizeof (entry->selector));
+			entry->id = id;
+			entry->field = chunk_fields[i].field;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// Chunk values use the GenICam default register endianness (little endian)
+static guint64
+read_uint (const guint8 * p, guint32 len)
+{
+	if (len >= 8)
+		return GST_READ_UINT64_LE (p);
+	if (len >= 4)
+		return GST_READ_UINT32_LE (p);
+	if (len >= 2)
+		return GST_READ_UINT16_LE (p);
+	return p[0];
+}
+
+// For signed counters; a 4 byte chunk holding -1 must come out as -1, not 4294967295
+static gint64
+read_int (const guint8 * p, guint32 len)
+{
+	if (len >= 8)
+		return (gint64) GST_READ_UINT64_LE (p);
+	if (len >= 4)
+		return (gint32) GST_READ_UINT32_LE (p);
+	if (len >= 2)
+		return (gint16) GST_READ_UINT16_LE (p);
+	return (gint8) p[0];
+}
+
+static gdouble
+read_float (const guint8 * p, guint32 len)
+{
+	if (len >= 8)
+		return GST_READ_DOUBLE_LE (p);
+	return GST_READ_FLOAT_LE (p);
+}
+
+// Parses the chunk trailers in data and stores the mapped values in meta.
+// Returns the number of chunks found, or stops early on a malformed trailer.
+guint
+gst_dalsa_chunk_parse (const guint8 * data, gsize size,
+		const GstDalsaChunkMapEntry * map, guint n_map, GstDalsaChunkMeta * meta)
+{
+	gsize pos = size;
+	guint n_chunks = 0;
+
+	while (pos >= 8) {
+		guint32 id = GST_READ_UINT32_BE (data + pos - 8);
+		guint32 len = GST_READ_UINT32_BE (data + pos - 4);
+		const guint8 *value;
+
+		if (len > pos - 8)
+			break;
+		pos -= 8 + len;
+		value = data + pos;
+		n_chunks++;
+
+		if (len == 0)
+			continue;
+
+		for (guint i = 0; i < n_map; i++) {
+			if (map[i].id != id)
+				continue;
+			if (len < 4 && (map[i].field == GST_DALSA_CHUNK_EXPOSURE_TIME ||
+					map[i].field == GST_DALSA_CHUNK_GAIN))
+				break;
+
+			switch (map[i].field) {
+			case GST_DALSA_CHUNK_EXPOSURE_TIME:
+				meta->exposure_time = read_float (value, len);
+				break;
+			case GST_DALSA_CHUNK_GAIN:
+				meta->gain = read_float (value, len);
+				break;
+			case GST_DALSA_CHUNK_FRAME_ID:
+				meta->frame_id = read_uint (value, len);
+				break;
+			case GST_DALSA_CHUNK_LINE_STATUS:
+				meta->line_status = (guint32) read_uint (value, len);
+				break;
+			case GST_DALSA_CHUNK_ENCODER_VALUE:
+				meta->encoder_value = read_int (value, len);
+				break;
+			case GST_DALSA_CHUNK_TIMESTAMP:
+				meta->timestamp = read_uint (value, len);
+				break;
+			}
+			meta->fields |= map[i].field;
+			break;
+		}
+	}
+
+	return n_chunks;
+}
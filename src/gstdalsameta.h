@@ -0,0 +1,83 @@
+/* GStreamer Teledyne Dalsa Plugin
+ * Copyright (C) 2021 David Thompson, Embry-Riddle Aeronautical University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _GST_DALSA_META_H_
+#define _GST_DALSA_META_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_DALSA_CHUNK_META_API_TYPE (gst_dalsa_chunk_meta_api_get_type())
+#define GST_DALSA_CHUNK_META_INFO  (gst_dalsa_chunk_meta_get_info())
+
+#define gst_buffer_get_dalsa_chunk_meta(b) \
+  ((GstDalsaChunkMeta*)gst_buffer_get_meta((b),GST_DALSA_CHUNK_META_API_TYPE))
+
+// Maximum number of chunks mapped to meta fields
+#define GST_DALSA_CHUNK_MAX	8
+
+typedef struct _GstDalsaChunkMeta GstDalsaChunkMeta;
+typedef struct _GstDalsaChunkMapEntry GstDalsaChunkMapEntry;
+
+// Bit set in GstDalsaChunkMeta.fields for every value that was present in the frame
+typedef enum
+{
+	GST_DALSA_CHUNK_EXPOSURE_TIME = (1 << 0),
+	GST_DALSA_CHUNK_GAIN          = (1 << 1),
+	GST_DALSA_CHUNK_FRAME_ID      = (1 << 2),
+	GST_DALSA_CHUNK_LINE_STATUS   = (1 << 3),
+	GST_DALSA_CHUNK_ENCODER_VALUE = (1 << 4),
+	GST_DALSA_CHUNK_TIMESTAMP     = (1 << 5)
+} GstDalsaChunkField;
+
+// Maps a GenICam ChunkSelector name and the chunk ID the camera uses for it to a meta field
+struct _GstDalsaChunkMapEntry
+{
+  gchar selector[32];
+  guint32 id;
+  GstDalsaChunkField field;
+};
+
+struct _GstDalsaChunkMeta
+{
+  GstMeta meta;
+
+  GstDalsaChunkField fields;  // which of the values below are valid
+  gdouble exposure_time;      // us
+  gdouble gain;
+  guint64 frame_id;
+  guint32 line_status;
+  gint64 encoder_value;
+  guint64 timestamp;          // camera timestamp, in camera ticks
+};
+
+GType gst_dalsa_chunk_meta_api_get_type (void);
+const GstMetaInfo *gst_dalsa_chunk_meta_get_info (void);
+
+GstDalsaChunkMeta *gst_buffer_add_dalsa_chunk_meta (GstBuffer * buffer);
+
+gboolean gst_dalsa_chunk_map_entry_init (GstDalsaChunkMapEntry * entry,
+    const gchar * selector, guint32 id);
+guint gst_dalsa_chunk_parse (const guint8 * data, gsize size,
+    const GstDalsaChunkMapEntry * map, guint n_map, GstDalsaChunkMeta * meta);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,153 @@
+/* GStreamer Teledyne Dalsa Plugin
+ * Copyright (C) 2021 David Thompson, Embry-Riddle Aeronautical University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Checks gst_dalsa_chunk_parse() on a synthetic chunk payload and measures what it
+ * costs per frame. No camera is needed; the payload has the same layout the camera
+ * sends: every chunk value is followed by a big-endian ID and length trailer.
+ *
+ *   chunk-parse [iterations]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gstdalsameta.h"
+
+#define N_ITERATIONS	1000000
+#define FILLER_SIZE		64      // an enabled chunk the meta has no field for
+
+typedef struct
+{
+	const gchar *selector;
+	guint32 id;
+} ChunkId;
+
+static const ChunkId chunk_ids[] = {
+	{ "ExposureTime",  0xA0001001 },
+	{ "Gain",          0xA0001002 },
+	{ "FrameID",       0xA0001003 },
+	{ "LineStatusAll", 0xA0001006 },
+	{ "EncoderValue",  0xA0001007 },
+	{ "Timestamp",     0xA0001008 }
+};
+
+static gsize
+append_chunk (guint8 * data, gsize pos, guint32 id, const guint8 * value, guint32 len)
+{
+	memcpy (data + pos, value, len);
+	GST_WRITE_UINT32_BE (data + pos + len, id);
+	GST_WRITE_UINT32_BE (data + pos + len + 4, len);
+	return pos + len + 8;
+}
+
+static gsize
+build_payload (guint8 * data)
+{
+	guint8 value[FILLER_SIZE] = {0};
+	gsize pos = 0;
+
+	pos = append_chunk (data, pos, 0xA0009999, value, FILLER_SIZE);
+	GST_WRITE_DOUBLE_LE (value, 10000.0);
+	pos = append_chunk (data, pos, chunk_ids[0].id, value, 8);
+	GST_WRITE_DOUBLE_LE (value, 2.5);
+	pos = append_chunk (data, pos, chunk_ids[1].id, value, 8);
+	GST_WRITE_UINT64_LE (value, 123456);
+	pos = append_chunk (data, pos, chunk_ids[2].id, value, 8);
+	GST_WRITE_UINT32_LE (value, 0x5);
+	pos = append_chunk (data, pos, chunk_ids[3].id, value, 4);
+	GST_WRITE_UINT64_LE (value, (guint64) -42);
+	pos = append_chunk (data, pos, chunk_ids[4].id, value, 8);
+	GST_WRITE_UINT64_LE (value, G_GUINT64_CONSTANT (0x0123456789ABCDEF));
+	pos = append_chunk (data, pos, chunk_ids[5].id, value, 8);
+
+	return pos;
+}
+
+int
+main (int argc, char **argv)
+{
+	GstDalsaChunkMapEntry map[GST_DALSA_CHUNK_MAX];
+	GstDalsaChunkMeta meta;
+	guint8 data[512];
+	gsize size;
+	guint n_map = 0, n_chunks;
+	guint64 iterations = (argc > 1) ? g_ascii_strtoull (argv[1], NULL, 10) : N_ITERATIONS;
+	guint64 check = 0;
+	gint64 start, elapsed;
+
+	for (guint i = 0; i < G_N_ELEMENTS (chunk_ids); i++) {
+		if (!gst_dalsa_chunk_map_entry_init (&map[n_map], chunk_ids[i].selector, chunk_ids[i].id)) {
+			g_printerr ("selector %s not accepted\n", chunk_ids[i].selector);
+			return EXIT_FAILURE;
+		}
+		n_map++;
+	}
+	size = build_payload (data);
+
+	memset (&meta, 0, sizeof (meta));
+	n_chunks = gst_dalsa_chunk_parse (data, size, map, n_map, &meta);
+	if (n_chunks != G_N_ELEMENTS (chunk_ids) + 1 ||
+			meta.fields != (GST_DALSA_CHUNK_EXPOSURE_TIME | GST_DALSA_CHUNK_GAIN |
+				GST_DALSA_CHUNK_FRAME_ID | GST_DALSA_CHUNK_LINE_STATUS |
+				GST_DALSA_CHUNK_ENCODER_VALUE | GST_DALSA_CHUNK_TIMESTAMP) ||
+			meta.exposure_time != 10000.0 || meta.gain != 2.5 || meta.frame_id != 123456 ||
+			meta.line_status != 0x5 || meta.encoder_value != -42 ||
+			meta.timestamp != G_GUINT64_CONSTANT (0x0123456789ABCDEF)) {
+		g_printerr ("parsed values do not match the payload\n");
+		return EXIT_FAILURE;
+	}
+
+	// EncoderValue is signed and usually sent as 4 bytes, so it has to be sign extended
+	GST_WRITE_UINT32_LE (data, (guint32) -1);
+	GST_WRITE_UINT32_BE (data + 4, chunk_ids[4].id);
+	GST_WRITE_UINT32_BE (data + 8, 4);
+	memset (&meta, 0, sizeof (meta));
+	if (gst_dalsa_chunk_parse (data, 12, map, n_map, &meta) != 1 ||
+			meta.fields != GST_DALSA_CHUNK_ENCODER_VALUE || meta.encoder_value != -1) {
+		g_printerr ("4 byte negative encoder value was not sign extended\n");
+		return EXIT_FAILURE;
+	}
+	size = build_payload (data);
+
+	// A trailer claiming more data than precedes it must stop the parser, not read out of bounds
+	GST_WRITE_UINT32_BE (data + size - 4, size);
+	memset (&meta, 0, sizeof (meta));
+	if (gst_dalsa_chunk_parse (data, size, map, n_map, &meta) != 0 || meta.fields != 0) {
+		g_printerr ("malformed trailer was not rejected\n");
+		return EXIT_FAILURE;
+	}
+	size = build_payload (data);
+
+	start = g_get_monotonic_time ();
+	for (guint64 i = 0; i < iterations; i++) {
+		meta.fields = 0;
+		// Vary one value so the loop can not be hoisted
+		GST_WRITE_UINT64_LE (data + size - 16, i);
+		gst_dalsa_chunk_parse (data, size, map, n_map, &meta);
+		check += meta.timestamp;
+	}
+	elapsed = g_get_monotonic_time () - start;
+
+	g_print ("%u chunks, %" G_GSIZE_FORMAT " bytes: %.1f ns per frame over %" G_GUINT64_FORMAT
+			" frames (check %" G_GUINT64_FORMAT ")\n", n_chunks, size,
+			elapsed * 1000.0 / MAX (iterations, 1), iterations, check);
+
+	return EXIT_SUCCESS;
+}